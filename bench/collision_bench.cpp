@@ -0,0 +1,149 @@
+/*
+ * Collision benchmark - times Maze::queryWalls() and Maze::sweep() for
+ * random steps of player movement through a maze.
+ *
+ * Positions are spread over the open tiles of the maze, each paired with
+ * a step in a random direction. Every query's contacts are checked
+ * against the box so the work to resolve them is counted too. Sweeps are
+ * timed at walking speed and at --step tiles per move. Fixed mazes also
+ * report how many faces merging straight runs, as the renderer does,
+ * would leave in place of the per tile ones.
+ *
+ * ./collision_bench [--seed n] [--endless] [--step n] [size [queries]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+#include "../src/maze.h"
+#include "../src/bitplane.h"
+
+static const float BOUND = 0.05f;
+static const float STEP = 1.5f / 60.0f;
+
+static void usage() {
+    std::cerr << "./collision_bench [--seed n] [--endless] [--step n] "
+        << "[size [queries]]\n"
+        << "\tstep: length of the long sweeps in tiles (4 by default)\n"
+        << "\tsize: side of square maze in cells (256 by default)\n"
+        << "\tqueries: number of queries to time (10000000 by default)\n";
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    uint64_t seed = 1;
+    bool endless = false;
+    float longStep = 4.0f;
+    std::vector<long> numbers;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--step" && i + 1 < argc)
+            longStep = atof(argv[++i]);
+        else if (arg == "--endless")
+            endless = true;
+        else if (atol(argv[i]) > 0 && numbers.size() < 2)
+            numbers.push_back(atol(argv[i]));
+        else
+            usage();
+    }
+    const int size = numbers.size() > 0 ? numbers[0] : 256;
+    const long queries = numbers.size() > 1 ? numbers[1] : 10000000;
+
+    Maze m(size, size, Algorithm::Backtracker, seed, 1, endless);
+    // Endless mode only has the chunks around the player, keep the
+    // positions within those
+    const int span = endless ? CHUNK_TILES : m.getWidth() - 2;
+    m.stream(glm::vec2(CHUNK_TILES / 2, CHUNK_TILES / 2));
+
+    // A few thousand starting points in open tiles, so the queries see a
+    // mix of corridors, corners and dead ends
+    Random rng(seed);
+    struct Step { glm::vec2 pos, motion; };
+    std::vector<Step> steps;
+    while (steps.size() < 4096) {
+        int x = 1 + rng.below(span), y = 1 + rng.below(span);
+        if (m.getTile(x, y).type == Type::Wall)
+            continue;
+        float angle = rng.below(6283) / 1000.0f;
+        glm::vec2 offset(rng.below(1000) / 1000.0f, rng.below(1000) / 1000.0f);
+        steps.push_back({glm::vec2(x, y) + offset,
+                         STEP * glm::vec2(cosf(angle), sinf(angle))});
+    }
+
+    WallContact walls[MAX_CONTACTS];
+    long contacts = 0, touching = 0;
+    auto elapsed = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (long q = 0; q < queries; ++q) {
+        const Step& s = steps[q & (steps.size() - 1)];
+        int n = m.queryWalls(s.pos, glm::vec2(BOUND), s.motion,
+                             walls, MAX_CONTACTS);
+        contacts += n;
+        glm::vec2 next = s.pos + s.motion;
+        for (int k = 0; k < n; ++k) {
+            float across = walls[k].vertical ? next.x : next.y;
+            touching += fabs(across - walls[k].at) <= BOUND;
+        }
+    }
+    double seconds = elapsed(start);
+
+    // Sweeps, at walking speed and with long steps. Summing where they
+    // end up keeps the compiler from dropping them.
+    double sweepSeconds[2];
+    glm::vec2 sum(0.0f);
+    for (int k = 0; k < 2; ++k) {
+        float scale = k ? longStep / STEP : 1.0f;
+        start = std::chrono::steady_clock::now();
+        for (long q = 0; q < queries; ++q) {
+            const Step& s = steps[q & (steps.size() - 1)];
+            sum += m.sweep(s.pos, glm::vec2(BOUND), s.motion * scale);
+        }
+        sweepSeconds[k] = elapsed(start);
+    }
+
+    // How far merging straight runs would shrink the faces, only for
+    // fixed mazes
+    size_t faces = 0;
+    std::vector<FaceRun> runs;
+    if (!endless) {
+        Face tileFaces[4];
+        for (int y = 0; y < m.getHeight(); ++y)
+            for (int x = 0; x < m.getWidth(); ++x)
+                faces += m.facesAt(x, y, tileFaces);
+        Bitplane walls, planes[4];
+        wallPlane(m.getGrid(), walls);
+        exposedFaces(walls, planes);
+        for (int d = 0; d < 4; ++d)
+            faceRuns(planes[d], (Dir) d, runs);
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+        << (endless ? "endless" : "maze ") << (endless ? "" :
+            std::to_string(size) + "x" + std::to_string(size))
+        << ", seed " << seed << '\n';
+    if (!endless)
+        std::cout << faces << " faces merged into "
+            << runs.size() << " runs, "
+            << (double) faces / runs.size() << "x fewer\n";
+    std::cout
+        << queries << " queries in " << seconds << "s, "
+        << queries / seconds / 1e6 << " M queries/s\n"
+        << (double) contacts / queries << " faces per query, "
+        << (double) touching / queries << " in reach of the box\n"
+        << "sweep " << STEP << " tiles: "
+        << queries / sweepSeconds[0] / 1e6 << " M sweeps/s\n"
+        << "sweep " << longStep << " tiles: "
+        << queries / sweepSeconds[1] / 1e6 << " M sweeps/s"
+        << (sum.x == 0.0f ? " " : "") << '\n';
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Generation benchmark - carves square mazes of a few sizes with every
+ * algorithm and reports cells per second and peak memory, then times the
+ * bitplane kernels that find exposed wall faces and count dead ends and
+ * junctions.
+ *
+ * Each run happens in its own forked process so peak resident memory
+ * (ru_maxrss) can be read back per algorithm and size. Memory is shown
+ * relative to an idle child, so covers the WallGrid, the one byte per cell
+ * scratch array and anything the algorithm allocates itself.
+ *
+ * ./maze_bench [--threads n] [--seed n] [size ...]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../src/generator.h"
+#include "../src/wall_grid.h"
+#include "../src/bitplane.h"
+
+struct Result {
+    double seconds;
+    long peakKB;
+};
+
+// Run f in a child process, returning the time it reports and the
+// child's peak resident memory
+template <typename F>
+static bool runIsolated(F f, Result& result) {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        double seconds = f();
+        ssize_t written = write(fds[1], &seconds, sizeof(seconds));
+        _exit(written == sizeof(seconds) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0)
+        return false;
+
+    ssize_t got = read(fds[0], &result.seconds, sizeof(result.seconds));
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || got != sizeof(double))
+        return false;
+    result.peakKB = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double carve(Algorithm a, int size, uint64_t seed, int threads) {
+    WallGrid grid(size, size);
+    std::vector<uint8_t> scratch((size_t) size * size);
+    Random rng(seed);
+
+    auto start = std::chrono::steady_clock::now();
+    if (threads > 1)
+        carvePartitioned(a, grid, scratch.data(), seed, threads);
+    else
+        carveRegion(a, grid, scratch.data(), rng, 0, 0, size, size);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Time building the wall plane, extracting faces and counting branches
+// of a backtracker maze
+static void analyse(int size, uint64_t seed) {
+    WallGrid grid(size, size);
+    std::vector<uint8_t> scratch((size_t) size * size);
+    Random rng(seed);
+    carveRegion(Algorithm::Backtracker, grid, scratch.data(), rng,
+                0, 0, size, size);
+
+    Bitplane walls, faces[4];
+    size_t deadEnds, junctions;
+    auto t0 = std::chrono::steady_clock::now();
+    wallPlane(grid, walls);
+    auto t1 = std::chrono::steady_clock::now();
+    exposedFaces(walls, faces);
+    auto t2 = std::chrono::steady_clock::now();
+    countBranches(walls, deadEnds, junctions);
+    auto t3 = std::chrono::steady_clock::now();
+
+    size_t count = 0;
+    for (auto& plane : faces)
+        count += plane.count();
+    auto ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    std::cout << std::setw(8) << size
+        << std::setprecision(2) << std::setw(10) << ms(t1 - t0)
+        << std::setw(10) << ms(t2 - t1)
+        << std::setw(10) << ms(t3 - t2)
+        << std::setw(12) << count
+        << std::setw(11) << deadEnds
+        << std::setw(11) << junctions << '\n';
+}
+
+static void usage() {
+    std::cerr << "./maze_bench [--threads n] [--seed n] [size ...]\n"
+        << "\tsize: side of square maze in cells "
+        << "(256, 1024 and 4096 by default)\n";
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    int threads = 1;
+    uint64_t seed = 1;
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--threads" || arg == "--seed") && i + 1 < argc) {
+            if (arg == "--threads")
+                threads = std::max(1, atoi(argv[++i]));
+            else
+                seed = strtoull(argv[++i], NULL, 10);
+        } else if (atoi(argv[i]) > 1) {
+            sizes.push_back(atoi(argv[i]));
+        } else {
+            usage();
+        }
+    }
+    if (sizes.empty())
+        sizes = {256, 1024, 4096};
+
+    Result idle;
+    if (!runIsolated([] { return 0.0; }, idle)) {
+        std::cerr << "Failed to run benchmark process\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "seed " << seed << ", " << threads << " thread(s)\n\n"
+        << std::left << std::setw(13) << "algorithm"
+        << std::right << std::setw(8) << "size"
+        << std::setw(12) << "seconds"
+        << std::setw(14) << "Mcells/s"
+        << std::setw(12) << "peak MB" << '\n';
+    std::cout << std::fixed;
+
+    for (int a = 0; a < (int) Algorithm::Count; ++a) {
+        for (int size : sizes) {
+            Result r;
+            Algorithm algorithm = (Algorithm) a;
+            bool ok = runIsolated([=] {
+                return carve(algorithm, size, seed, threads);
+            }, r);
+
+            std::cout << std::left << std::setw(13) << algorithmName(algorithm)
+                << std::right << std::setw(8) << size;
+            if (!ok) {
+                std::cout << "  failed\n";
+                continue;
+            }
+            double cells = (double) size * size;
+            std::cout << std::setprecision(4) << std::setw(12) << r.seconds
+                << std::setprecision(2) << std::setw(14)
+                << cells / r.seconds / 1e6
+                << std::setw(12) << (r.peakKB - idle.peakKB) / 1024.0 << '\n';
+        }
+    }
+
+    std::cout << "\nbitplane kernels (ms), backtracker\n"
+        << std::setw(8) << "size" << std::setw(10) << "walls"
+        << std::setw(10) << "faces" << std::setw(10) << "branches"
+        << std::setw(12) << "faces" << std::setw(11) << "dead ends"
+        << std::setw(11) << "junctions" << '\n';
+    for (int size : sizes)
+        analyse(size, seed);
+    return 0;
+}
@@ -1 +1,3 @@
-g++ -std=c++11 -O3 -DGLM_FORCE_CTOR_INIT -o maze src/window.cpp src/input.cpp src/minimap.cpp src/maze.cpp src/camera.cpp src/main.cpp src/renderer.cpp -lGL -lGLU -lglut -lGLEW
+g++ -std=c++11 -O3 -march=native -pthread -DGLM_FORCE_CTOR_INIT -o maze src/window.cpp src/glut_input.cpp src/minimap.cpp src/maze.cpp src/wall_grid.cpp src/generator.cpp src/chunk_cache.cpp src/bitplane.cpp src/camera.cpp src/main.cpp src/renderer.cpp src/pvs.cpp src/noise.cpp src/light_grid.cpp src/render_targets.cpp src/offscreen.cpp -lGL -lGLU -lglut -lGLEW -lEGL
+g++ -std=c++11 -O3 -march=native -pthread -o maze_bench bench/generate_bench.cpp src/generator.cpp src/wall_grid.cpp src/bitplane.cpp
+g++ -std=c++11 -O3 -march=native -pthread -DGLM_FORCE_CTOR_INIT -o collision_bench bench/collision_bench.cpp src/maze.cpp src/wall_grid.cpp src/generator.cpp src/chunk_cache.cpp src/bitplane.cpp
@@ -0,0 +1,283 @@
+#include "bitplane.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+
+static const uint64_t ALL = ~(uint64_t) 0;
+// Every even tile of a row
+static const uint64_t EVEN = 0x5555555555555555ull;
+
+void Bitplane::resize(int w, int h) {
+    width = w;
+    height = h;
+    stride = (w + 63) / 64;
+    words.assign((size_t) stride * h, 0);
+}
+
+void Bitplane::clear() {
+    std::fill(words.begin(), words.end(), 0);
+}
+
+size_t Bitplane::count() const {
+    size_t n = 0;
+    for (uint64_t w : words)
+        n += __builtin_popcountll(w);
+    return n;
+}
+
+size_t Bitplane::countAnd(const Bitplane& other) const {
+    size_t n = 0;
+    for (size_t i = 0; i < words.size(); ++i)
+        n += __builtin_popcountll(words[i] & other.words[i]);
+    return n;
+}
+
+uint64_t Bitplane::lastMask() const {
+    return width & 63 ? ((uint64_t) 1 << (width & 63)) - 1 : ALL;
+}
+
+// Spread the 8 bits of b out to the even bits, bit i to bit 2i
+static uint64_t spread(uint8_t b) {
+    uint64_t x = b;
+    x = (x | x << 4) & 0x0F0F;
+    x = (x | x << 2) & 0x3333;
+    x = (x | x << 1) & 0x5555;
+    return x;
+}
+
+// OR the (at most 16) bits into row starting at tile pos
+static void orAt(uint64_t* row, int stride, int pos, uint64_t bits) {
+    const int k = pos >> 6;
+    const int s = pos & 63;
+    row[k] |= bits << s;
+    if (s > 48 && k + 1 < stride)
+        row[k + 1] |= bits >> (64 - s);
+}
+
+// Rows of expanded tiles alternate between cells with the walls east of
+// them and the walls north of a row of cells with pillars in between.
+// Both are built a byte of the WallGrid (8 cells, 16 tiles) at a time.
+void wallPlane(const WallGrid& grid, Bitplane& walls) {
+    const int w = grid.getWidth();
+    const int h = grid.getHeight();
+    walls.resize(w, h);
+    const int stride = walls.getStride();
+    const int blocksW = (grid.getCellsW() + 7) / 8;
+    const uint64_t pad = ~walls.lastMask();
+
+    for (int y = 0; y < h; ++y) {
+        uint64_t* row = walls.row(y);
+        if (y == 0 || y == h - 1) {
+            for (int k = 0; k < stride; ++k)
+                row[k] = ALL;
+            continue;
+        }
+        if (y & 1) {
+            const int cy = y >> 1;
+            row[0] = 1;
+            for (int bx = 0; bx < blocksW; ++bx)
+                orAt(row, stride, 16*bx + 2, spread(grid.eastWalls(bx, cy)));
+            row[(w - 1) >> 6] |= (uint64_t) 1 << ((w - 1) & 63);
+        } else {
+            const int cy = (y >> 1) - 1;
+            for (int k = 0; k < stride; ++k)
+                row[k] = EVEN;
+            for (int bx = 0; bx < blocksW; ++bx)
+                orAt(row, stride, 16*bx + 1, spread(grid.northWalls(bx, cy)));
+        }
+        row[stride - 1] |= pad;
+    }
+}
+
+// Row y of a plane and the rows either side of it, solid wall past the
+// top and bottom
+struct Rows {
+    const uint64_t* self;
+    const uint64_t* north;
+    const uint64_t* south;
+    int stride;
+
+    Rows(const Bitplane& p, int y, const std::vector<uint64_t>& solid) :
+        self(p.row(y)),
+        north(y + 1 < p.getHeight() ? p.row(y + 1) : solid.data()),
+        south(y > 0 ? p.row(y - 1) : solid.data()),
+        stride(p.getStride()) {}
+
+    // Word k with every bit replaced by its east/west neighbour, carrying
+    // across words. Off either end of the row is wall.
+    uint64_t east(int k) const {
+        uint64_t next = k + 1 < stride ? self[k + 1] : ALL;
+        return self[k] >> 1 | next << 63;
+    }
+    uint64_t west(int k) const {
+        uint64_t prev = k > 0 ? self[k - 1] : ALL;
+        return self[k] << 1 | prev >> 63;
+    }
+};
+
+#ifdef __AVX2__
+struct Lanes {
+    __m256i self, north, south, east, west;
+
+    Lanes(const Rows& r, int k) {
+        const __m256i* p = (const __m256i*) (r.self + k);
+        self = _mm256_loadu_si256(p);
+        north = _mm256_loadu_si256((const __m256i*) (r.north + k));
+        south = _mm256_loadu_si256((const __m256i*) (r.south + k));
+        __m256i next = _mm256_loadu_si256((const __m256i*) (r.self + k + 1));
+        __m256i prev = _mm256_loadu_si256((const __m256i*) (r.self + k - 1));
+        east = _mm256_or_si256(_mm256_srli_epi64(self, 1),
+                               _mm256_slli_epi64(next, 63));
+        west = _mm256_or_si256(_mm256_slli_epi64(self, 1),
+                               _mm256_srli_epi64(prev, 63));
+    }
+};
+
+static void store(uint64_t* out, __m256i v) {
+    _mm256_storeu_si256((__m256i*) out, v);
+}
+#endif
+
+void exposedFaces(const Bitplane& walls, Bitplane faces[4]) {
+    const int h = walls.getHeight();
+    const int stride = walls.getStride();
+    std::vector<uint64_t> solid(stride, ALL);
+    for (int d = 0; d < 4; ++d)
+        faces[d].resize(walls.getWidth(), h);
+
+    for (int y = 0; y < h; ++y) {
+        Rows r(walls, y, solid);
+        uint64_t* north = faces[(int) Dir::North].row(y);
+        uint64_t* east = faces[(int) Dir::East].row(y);
+        uint64_t* south = faces[(int) Dir::South].row(y);
+        uint64_t* west = faces[(int) Dir::West].row(y);
+
+        auto scalar = [&](int k) {
+            north[k] = r.self[k] & ~r.north[k];
+            south[k] = r.self[k] & ~r.south[k];
+            east[k] = r.self[k] & ~r.east(k);
+            west[k] = r.self[k] & ~r.west(k);
+        };
+        // AVX2 does 4 words at a time from word 1, while the words either
+        // side are still in the row
+        scalar(0);
+        int k = 1;
+#ifdef __AVX2__
+        for (; k + 4 < stride; k += 4) {
+            Lanes l(r, k);
+            store(north + k, _mm256_andnot_si256(l.north, l.self));
+            store(south + k, _mm256_andnot_si256(l.south, l.self));
+            store(east + k, _mm256_andnot_si256(l.east, l.self));
+            store(west + k, _mm256_andnot_si256(l.west, l.self));
+        }
+#endif
+        for (; k < stride; ++k)
+            scalar(k);
+    }
+}
+
+// North and south faces run along rows, found from where runs of bits
+// start and end in each word. East and west ones run up columns, each
+// followed up from the row it starts in.
+void faceRuns(const Bitplane& faces, Dir dir, std::vector<FaceRun>& runs) {
+    const int h = faces.getHeight();
+    const int stride = faces.getStride();
+    // Open tile each face faces, from its wall tile
+    const int offX = dir == Dir::East ? 1 : dir == Dir::West ? -1 : 0;
+    const int offY = dir == Dir::North ? 1 : dir == Dir::South ? -1 : 0;
+
+    for (int y = 0; y < h; ++y) {
+        const uint64_t* self = faces.row(y);
+        const uint64_t* below = y > 0 ? faces.row(y - 1) : NULL;
+        int start = 0;
+        for (int k = 0; k < stride; ++k) {
+            if (offX) {
+                uint64_t starts = below ? self[k] & ~below[k] : self[k];
+                while (starts) {
+                    const int x = k*64 + __builtin_ctzll(starts);
+                    starts &= starts - 1;
+                    int end = y + 1;
+                    while (end < h && faces.get(x, end))
+                        ++end;
+                    runs.push_back({x + offX, y, dir, end - y});
+                }
+                continue;
+            }
+            const uint64_t prev = k > 0 ? self[k - 1] >> 63 : 0;
+            const uint64_t next = k + 1 < stride ? self[k + 1] << 63 : 0;
+            const uint64_t starts = self[k] & ~(self[k] << 1 | prev);
+            const uint64_t ends = self[k] & ~(self[k] >> 1 | next);
+            uint64_t any = starts | ends;
+            while (any) {
+                const int b = __builtin_ctzll(any);
+                any &= any - 1;
+                if ((starts >> b) & 1)
+                    start = k*64 + b;
+                if ((ends >> b) & 1)
+                    runs.push_back({start, y + offY, dir,
+                                    k*64 + b + 1 - start});
+            }
+        }
+    }
+}
+
+// Wall neighbours are summed bit-sliced, each word holding one bit of the
+// 0-4 count for 64 tiles. Pairs are added with half adders, then the two
+// 2-bit sums; a carry out of the low bits can only happen when neither
+// pair was both walls, so the high bits never need a full add. A dead end
+// has three walls around it, a junction one or none.
+void countBranches(const Bitplane& walls, size_t& deadEnds,
+                   size_t& junctions) {
+    const int h = walls.getHeight();
+    const int stride = walls.getStride();
+    std::vector<uint64_t> solid(stride, ALL);
+    deadEnds = 0;
+    junctions = 0;
+
+    for (int y = 0; y < h; ++y) {
+        Rows r(walls, y, solid);
+
+        auto scalar = [&](int k) {
+            uint64_t e = r.east(k), w = r.west(k);
+            uint64_t a = e ^ w, ca = e & w;
+            uint64_t b = r.north[k] ^ r.south[k], cb = r.north[k] & r.south[k];
+            uint64_t s0 = a ^ b;
+            uint64_t s1 = ca ^ cb ^ (a & b);
+            uint64_t s2 = ca & cb;
+            uint64_t open = ~r.self[k];
+            deadEnds += __builtin_popcountll(open & s0 & s1 & ~s2);
+            junctions += __builtin_popcountll(open & ~(s1 | s2));
+        };
+        scalar(0);
+        int k = 1;
+#ifdef __AVX2__
+        for (; k + 4 < stride; k += 4) {
+            Lanes l(r, k);
+            __m256i a = _mm256_xor_si256(l.east, l.west);
+            __m256i ca = _mm256_and_si256(l.east, l.west);
+            __m256i b = _mm256_xor_si256(l.north, l.south);
+            __m256i cb = _mm256_and_si256(l.north, l.south);
+            __m256i s0 = _mm256_xor_si256(a, b);
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ca, cb),
+                                          _mm256_and_si256(a, b));
+            __m256i s2 = _mm256_and_si256(ca, cb);
+            __m256i dead = _mm256_andnot_si256(s2, _mm256_and_si256(s0, s1));
+            __m256i junction = _mm256_andnot_si256(
+                _mm256_or_si256(s1, s2), _mm256_set1_epi64x(-1));
+            dead = _mm256_andnot_si256(l.self, dead);
+            junction = _mm256_andnot_si256(l.self, junction);
+            uint64_t d[4], j[4];
+            store(d, dead);
+            store(j, junction);
+            for (int i = 0; i < 4; ++i) {
+                deadEnds += __builtin_popcountll(d[i]);
+                junctions += __builtin_popcountll(j[i]);
+            }
+        }
+#endif
+        for (; k < stride; ++k)
+            scalar(k);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+/*
+ * Bitplane - one bit per tile of the expanded grid, packed 64 tiles to a
+ * word along x, each row padded out to a whole number of words.
+ *
+ * Questions about a tile's neighbours (which wall faces are exposed,
+ * how many ways out a floor tile has) become shifts and ANDs over whole
+ * words, answering 64 tiles at a time, or 256 with AVX2, rather than
+ * branching per tile. Sets of tiles (visited, on the path) are kept the
+ * same way, so clearing and counting them is a word at a time too.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "wall_grid.h"
+#include "mesher.h"
+
+class Bitplane {
+public:
+    Bitplane() : width(0), height(0), stride(0) {}
+
+    // Resize to w x h tiles, all clear
+    void resize(int w, int h);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    // Words per row
+    int getStride() const { return stride; }
+    uint64_t* row(int y) { return &words[(size_t) y * stride]; }
+    const uint64_t* row(int y) const { return &words[(size_t) y * stride]; }
+
+    bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    void set(int x, int y) { row(y)[x >> 6] |= (uint64_t) 1 << (x & 63); }
+    void reset(int x, int y) {
+        row(y)[x >> 6] &= ~((uint64_t) 1 << (x & 63));
+    }
+    // Clear every bit, keeping the size
+    void clear();
+    // Number of set bits, padding included
+    size_t count() const;
+    // Number of bits set both here and in other, which must be the same
+    // size
+    size_t countAnd(const Bitplane& other) const;
+    // Bits of the last word in each row that are inside the plane
+    uint64_t lastMask() const;
+
+private:
+    int width;
+    int height;
+    int stride;
+    std::vector<uint64_t> words;
+};
+
+// Wall tiles of grid's expanded grid. Padding past the end of each row is
+// set, so reads as wall.
+void wallPlane(const WallGrid& grid, Bitplane& walls);
+
+// faces[d] gets the wall tiles whose neighbour in direction d is open,
+// i.e. that have a face exposed that way. Indexed by Dir.
+void exposedFaces(const Bitplane& walls, Bitplane faces[4]);
+
+// Runs of faces facing dir, given faces[dir] from exposedFaces(), the
+// same runs meshFaces() finds but for the whole plane and a word at a
+// time along rows
+void faceRuns(const Bitplane& faces, Dir dir, std::vector<FaceRun>& runs);
+
+// Count open tiles with exactly one open neighbour (dead ends) and with
+// three or more (junctions)
+void countBranches(const Bitplane& walls, size_t& deadEnds,
+                   size_t& junctions);
+
+#endif
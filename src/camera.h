@@ -2,7 +2,9 @@
 #define CAMERA_H
 
 /*
- * Camera - handles player movement, outputs view matrix to renderer
+ * Camera - handles player movement, outputs view matrix to renderer.
+ * Moves in fixed ticks of dt seconds and keeps the state from before the
+ * last one, so the view can be drawn anywhere in between.
  */
 
 #include <glm/glm.hpp>
@@ -16,28 +18,31 @@ public:
     Camera(Input&);
     ~Camera();
 
-    void update(Maze& m);
+    void update(Maze& m, float dt);
     void reset();
-    glm::mat4 getView();
-    glm::vec2 getPos();
+    // Jump to pos, looking level and yaw radians anticlockwise from
+    // north (+y), with nothing to interpolate from
+    void place(glm::vec2 p, float yaw);
+    // View and position alpha (0-1) of the way from the previous tick
+    // to the latest
+    glm::mat4 getView(float alpha = 1.0f);
+    glm::vec2 getPos(float alpha = 1.0f);
 
 private:
     Input& i;
-    glm::mat4 view;
     glm::vec3 pos;
     glm::vec3 up;
     glm::vec3 looking;
+    glm::vec3 prevPos;
+    glm::vec3 prevLooking;
     bool collision;
     bool endAnim;
+    float timeSinceWon; // Seconds
+    glm::vec2 winPos;
 
-    glm::vec3 processMovement();
+    glm::vec3 processMovement(float dt);
     glm::vec3 processCollision(Maze& m, glm::vec3 proposedMovement);
-    void processRotations();
-    bool lineAABBCollision(glm::vec3 newPos, Face& f);
-    float distFromPointToLine(
-            float x0, float y0,
-            float x1, float y1, 
-            float x2, float y2);
+    void processRotations(float dt);
 };
 
 #endif
@@ -0,0 +1,194 @@
+#include "chunk_cache.h"
+
+#include <algorithm>
+
+#include "random.h"
+
+static uint64_t chunkKey(int cx, int cy) {
+    return ((uint64_t) (uint32_t) cy << 32) | (uint32_t) cx;
+}
+
+// Seed for anything generated about chunk (cx, cy), salt picks which
+static uint64_t chunkSeed(uint64_t seed, int cx, int cy, uint64_t salt) {
+    return seed ^ (0x9E3779B97F4A7C15ull * (chunkKey(cx, cy) + 1)) ^
+        (salt * 0xD1B54A32D192ED03ull);
+}
+
+// Type of a tile from its chunk's walls, given coordinates within it.
+// Even coordinates are cells, odd ones the passages east/north of them.
+static Type localType(const WallGrid& walls, int lx, int ly) {
+    const bool oddX = lx & 1;
+    const bool oddY = ly & 1;
+    if (!oddX && !oddY)
+        return Type::Floor;
+    if (oddX && oddY)
+        return Type::Wall;
+    Dir d = oddX ? Dir::East : Dir::North;
+    return walls.open(lx >> 1, ly >> 1, d) ? Type::Floor : Type::Wall;
+}
+
+// Eller's algorithm - carves one row at a time keeping only the set each
+// cell in the current row belongs to. Set labels are kept below
+// CHUNK_CELLS, there are never more sets than cells in a row.
+static void carveEller(WallGrid& walls, Random& rng) {
+    const int n = CHUNK_CELLS;
+    int sets[CHUNK_CELLS], next[CHUNK_CELLS];
+    int count[CHUNK_CELLS], chosen[CHUNK_CELLS];
+    bool used[CHUNK_CELLS];
+    std::fill(sets, sets + n, -1);
+
+    for (int y = 0; y < n; ++y) {
+        // Cells not joined from the row below start their own set
+        std::fill(used, used + n, false);
+        for (int x = 0; x < n; ++x)
+            if (sets[x] >= 0)
+                used[sets[x]] = true;
+        int label = 0;
+        for (int x = 0; x < n; ++x) {
+            if (sets[x] >= 0)
+                continue;
+            while (used[label])
+                ++label;
+            sets[x] = label;
+            used[label] = true;
+        }
+
+        // Randomly join neighbouring sets, the last row joins them all
+        const bool last = y == n - 1;
+        for (int x = 0; x + 1 < n; ++x) {
+            if (sets[x] == sets[x + 1] || !(last || rng.below(2)))
+                continue;
+            walls.carve(x, y, Dir::East);
+            int from = sets[x + 1];
+            for (int k = 0; k < n; ++k)
+                if (sets[k] == from)
+                    sets[k] = sets[x];
+        }
+        if (last)
+            break;
+
+        // Every set continues north through at least one random cell
+        std::fill(count, count + n, 0);
+        for (int x = 0; x < n; ++x)
+            if (rng.below(++count[sets[x]]) == 0)
+                chosen[sets[x]] = x;
+        for (int x = 0; x < n; ++x) {
+            next[x] = -1;
+            if (chosen[sets[x]] == x || rng.below(2)) {
+                walls.carve(x, y, Dir::North);
+                next[x] = sets[x];
+            }
+        }
+        std::copy(next, next + n, sets);
+    }
+}
+
+ChunkCache::ChunkCache(uint64_t seed, int radius, int capacity) :
+        seed(seed), radius(radius), clock(0), generated(0) {
+    slots.resize(std::max(capacity, (2*radius + 1) * (2*radius + 1)));
+    for (auto& c : slots) {
+        c.loaded = false;
+        c.lastUsed = 0;
+    }
+}
+
+int ChunkCache::borderOpening(int cx, int cy, bool north) const {
+    if (cx < 0 || cy < 0 || (north ? cy : cx) >= ENDLESS_CHUNKS - 1)
+        return -1;
+    Random rng(chunkSeed(seed, cx, cy, north ? 2 : 1));
+    return rng.below(CHUNK_CELLS);
+}
+
+void ChunkCache::stream(glm::vec2 pos) {
+    ++clock;
+    const int pcx = std::max(0, (int) pos.x - 1) / CHUNK_TILES;
+    const int pcy = std::max(0, (int) pos.y - 1) / CHUNK_TILES;
+    for (int cy = pcy - radius; cy <= pcy + radius; ++cy) {
+        for (int cx = pcx - radius; cx <= pcx + radius; ++cx) {
+            if (cx < 0 || cy < 0 ||
+                    cx >= ENDLESS_CHUNKS || cy >= ENDLESS_CHUNKS)
+                continue;
+            auto it = index.find(chunkKey(cx, cy));
+            if (it != index.end()) {
+                slots[it->second].lastUsed = clock;
+                continue;
+            }
+
+            // Reuse an empty slot, or the least recently used one
+            int slot = -1;
+            for (int i = 0; i < (int) slots.size(); ++i) {
+                if (!slots[i].loaded) {
+                    slot = i;
+                    break;
+                }
+                if (slot < 0 || slots[i].lastUsed < slots[slot].lastUsed)
+                    slot = i;
+            }
+            Chunk& c = slots[slot];
+            if (c.loaded)
+                index.erase(chunkKey(c.coord.x, c.coord.y));
+            c.coord = {cx, cy};
+            c.loaded = true;
+            c.lastUsed = clock;
+            generate(c);
+            index[chunkKey(cx, cy)] = slot;
+        }
+    }
+}
+
+void ChunkCache::generate(Chunk& c) {
+    const int cx = c.coord.x, cy = c.coord.y;
+    ++generated;
+    c.walls.resize(CHUNK_CELLS, CHUNK_CELLS);
+    Random rng(chunkSeed(seed, cx, cy, 0));
+    carveEller(c.walls, rng);
+
+    int row = borderOpening(cx, cy, false);
+    if (row >= 0)
+        c.walls.carve(CHUNK_CELLS - 1, row, Dir::East);
+    int col = borderOpening(cx, cy, true);
+    if (col >= 0)
+        c.walls.carve(col, CHUNK_CELLS - 1, Dir::North);
+
+    c.visited.assign(CHUNK_TILES * CHUNK_TILES / 64, 0);
+}
+
+const ChunkCache::Chunk* ChunkCache::find(int x, int y, int& lx, int& ly,
+                                          int* slot) const {
+    if (x <= 0 || y <= 0 || x >= getWidth() || y >= getHeight())
+        return NULL;
+    auto it = index.find(chunkKey((x - 1) / CHUNK_TILES,
+                                  (y - 1) / CHUNK_TILES));
+    if (it == index.end())
+        return NULL;
+    lx = (x - 1) % CHUNK_TILES;
+    ly = (y - 1) % CHUNK_TILES;
+    if (slot)
+        *slot = it->second;
+    return &slots[it->second];
+}
+
+Type ChunkCache::type(int x, int y) const {
+    int lx, ly;
+    const Chunk* c = find(x, y, lx, ly);
+    if (!c || x >= getWidth() - 1 || y >= getHeight() - 1)
+        return Type::Wall;
+    return localType(c->walls, lx, ly);
+}
+
+bool ChunkCache::isVisited(int x, int y) const {
+    int lx, ly;
+    const Chunk* c = find(x, y, lx, ly);
+    if (!c)
+        return false;
+    int t = ly * CHUNK_TILES + lx;
+    return (c->visited[t / 64] >> (t % 64)) & 1;
+}
+
+void ChunkCache::setVisited(int x, int y) {
+    int lx, ly, slot;
+    if (!find(x, y, lx, ly, &slot))
+        return;
+    int t = ly * CHUNK_TILES + lx;
+    slots[slot].visited[t / 64] |= (uint64_t) 1 << (t % 64);
+}
@@ -0,0 +1,79 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+/*
+ * ChunkCache - backing store for the endless maze.
+ *
+ * The world is split into square chunks of CHUNK_CELLS cells, each
+ * generated the first time the player comes near it from the world seed
+ * and its position, so a chunk always comes out the same however many
+ * times it is evicted and regenerated. Inside a chunk the maze is carved
+ * row by row with Eller's algorithm. Every chunk also opens one passage
+ * through its east and north borders, chosen from a hash of the border
+ * alone, so neighbouring chunks agree on where they join without either
+ * having to be loaded.
+ *
+ * Only a fixed number of chunks are kept. The least recently used ones
+ * are evicted, along with their visited (minimap) bits, so memory and per-frame cost stay constant however far the
+ * player walks.
+ */
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "wall_grid.h"
+
+static const int CHUNK_CELLS = 32;
+static const int CHUNK_TILES = CHUNK_CELLS * 2;
+// Chunks per side of the world. Limited so positions stay within float
+// precision of the ~0.025 tile steps the camera moves in.
+static const int ENDLESS_CHUNKS = 2048;
+
+class ChunkCache {
+public:
+    // Keeps at most capacity chunks, which must cover the (2*radius+1)^2
+    // chunks around the player
+    ChunkCache(uint64_t seed, int radius = 1, int capacity = 16);
+
+    // Make sure chunks around tile position pos are loaded, evicting the
+    // least recently used
+    void stream(glm::vec2 pos);
+
+    // Number of chunks generated so far, changes whenever tiles do
+    uint64_t getGenerated() const { return generated; }
+    // Size of the world in expanded tiles
+    int getWidth() const { return ENDLESS_CHUNKS * CHUNK_TILES + 1; }
+    int getHeight() const { return ENDLESS_CHUNKS * CHUNK_TILES + 1; }
+    // Tiles in chunks that are not loaded read as walls
+    Type type(int x, int y) const;
+    bool isVisited(int x, int y) const;
+    void setVisited(int x, int y);
+
+private:
+    struct Chunk {
+        glm::ivec2 coord;
+        bool loaded;
+        uint64_t lastUsed;
+        WallGrid walls;
+        std::vector<uint64_t> visited;
+    };
+
+    uint64_t seed;
+    int radius;
+    uint64_t clock;
+    uint64_t generated;
+    std::vector<Chunk> slots;
+    std::unordered_map<uint64_t, int> index; // chunk coord -> slot
+
+    // Chunk holding tile (x, y), NULL if not loaded, and the tile's
+    // coordinates within it
+    const Chunk* find(int x, int y, int& lx, int& ly, int* slot = NULL) const;
+    void generate(Chunk& c);
+    // Row/column of the passage through the east (or north) border of
+    // chunk (cx, cy), -1 if closed
+    int borderOpening(int cx, int cy, bool north) const;
+};
+
+#endif
@@ -54,15 +54,16 @@ std::vector<GLfloat> west = {
     -0.5f,  0.5f,  0.5f,  1.0f, 0.0f
 };
 
-// For the floor (top of a cube, rendered 1 unit below)
+// Unit quad the maze's faces and floors are all instances of, as two
+// counter-clockwise triangles
 
-std::vector<GLfloat> top = {
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f
+std::vector<GLfloat> quadCorners = {
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    1.0f, 1.0f,
+    1.0f, 1.0f,
+    0.0f, 1.0f,
+    0.0f, 0.0f
 };
 
 #endif
@@ -0,0 +1,52 @@
+#ifndef FACE_H
+#define FACE_H
+
+/*
+ * Face - one exposed side of a wall tile, as used for collision and for
+ * drawing walls. Faces are looked up by the open tile they face.
+ */
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdlib>
+
+#include "wall_grid.h"
+
+struct Face {
+    glm::vec2 tilePos;
+    glm::vec3 points[2];
+    glm::vec3 normal;
+    Dir dir;
+};
+
+typedef std::vector<Face> CollisionMesh;
+
+// Wall face found by a collision query. Faces are unit length and axis
+// aligned, so this is the line x = at (if vertical) or y = at, running
+// from `from` to from + 1 along the other axis.
+struct WallContact {
+    glm::vec2 normal;
+    float at;
+    float from;
+    bool vertical;
+};
+
+// Face of wall tile (tX, tY) given the x/y offsets of the open tile it
+// faces
+inline Face makeFace(int tX, int tY, int offX, int offY) {
+    int sX = offX > 0 ? 1 : 0;
+    int sY = offY > 0 ? 1 : 0;
+    Dir dir = offX > 0 ? Dir::East  :
+              offY > 0 ? Dir::North :
+              offX < 0 ? Dir::West  :
+                         Dir::South;
+    return {
+        glm::vec2(tX, tY),
+        {glm::vec3(tX + sX, tY + sY, 0.0f),
+         glm::vec3(tX + sX + abs(offY), tY + sY + abs(offX), 0.0f)},
+        glm::vec3(offX, offY, 0.0f),
+        dir
+    };
+}
+
+#endif
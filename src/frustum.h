@@ -0,0 +1,42 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+/*
+ * Frustum - the six planes bounding what a camera can see, pulled out of
+ * its projection * view matrix, for culling boxes that are off screen.
+ * Purely header since it is so small.
+ */
+
+#include <glm/glm.hpp>
+
+class Frustum {
+public:
+    // Planes are the sums/differences of the matrix's last row with each
+    // of the others (Gribb & Hartmann), pointing inwards
+    Frustum(const glm::mat4& viewProj) {
+        for (int i = 0; i < 3; ++i) {
+            for (int k = 0; k < 4; ++k) {
+                planes[2*i][k] = viewProj[k][3] + viewProj[k][i];
+                planes[2*i + 1][k] = viewProj[k][3] - viewProj[k][i];
+            }
+        }
+    }
+
+    // Could any of the box be inside? Tests the box's corner furthest
+    // along each plane's normal, so is conservative near the edges.
+    bool intersects(glm::vec3 min, glm::vec3 max) const {
+        for (const glm::vec4& p : planes) {
+            glm::vec3 far(p.x > 0 ? max.x : min.x,
+                          p.y > 0 ? max.y : min.y,
+                          p.z > 0 ? max.z : min.z);
+            if (p.x*far.x + p.y*far.y + p.z*far.z + p.w < 0)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    glm::vec4 planes[6]; // Left, right, bottom, top, near, far
+};
+
+#endif
@@ -0,0 +1,442 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Smallest region side (in cells) worth giving its own thread
+static const int MIN_REGION = 64;
+
+// Scratch states used by Prim and Wilson
+static const uint8_t IN_MAZE = 0x80;
+static const uint8_t FRONTIER = 0x40;
+
+static const char* NAMES[] = {
+    "backtracker",
+    "kruskal",
+    "prim",
+    "wilson",
+    "sidewinder",
+    "binarytree"
+};
+
+const char* algorithmName(Algorithm a) {
+    return NAMES[(int) a];
+}
+
+bool parseAlgorithm(const std::string& name, Algorithm& a) {
+    for (int i = 0; i < (int) Algorithm::Count; ++i) {
+        if (name == NAMES[i]) {
+            a = (Algorithm) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static Dir opposite(Dir d) {
+    return (Dir) (((int) d + 2) % 4);
+}
+
+// Move (x, y) and its cell index one step in direction d
+static void step(Dir d, int w, int& x, int& y, size_t& cell) {
+    switch (d) {
+        case Dir::East:  ++x; cell += 1; break;
+        case Dir::North: ++y; cell += w; break;
+        case Dir::West:  --x; cell -= 1; break;
+        case Dir::South: --y; cell -= w; break;
+    }
+}
+
+// Union-find with path halving, for joining regions/cells into one tree
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t n) : parent(n) {
+        for (size_t i = 0; i < n; ++i)
+            parent[i] = (uint32_t) i;
+    }
+
+    uint32_t find(uint32_t a) {
+        while (parent[a] != a) {
+            parent[a] = parent[parent[a]];
+            a = parent[a];
+        }
+        return a;
+    }
+
+    // Returns false if a and b were already joined
+    bool join(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return false;
+        parent[std::max(a, b)] = std::min(a, b);
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> parent;
+};
+
+// Backtracking follows the stored parent direction rather than a stack of
+// cells, so the only memory used is the parents array itself.
+void carveBacktracker(WallGrid& grid, uint8_t* parents, Random& rng,
+                      int x0, int y0, int x1, int y1,
+                      int startX, int startY) {
+    const int w = grid.getCellsW();
+    for (int y = y0; y < y1; ++y)
+        std::fill(parents + (size_t) y * w + x0,
+                  parents + (size_t) y * w + x1, PARENT_UNVISITED);
+
+    int x = startX, y = startY;
+    size_t cell = (size_t) y * w + x;
+    parents[cell] = PARENT_ROOT;
+    for (;;) {
+        // Unvisited neighbours, one is picked at random in place
+        Dir dirs[4];
+        int n = 0;
+        if (x + 1 < x1 && parents[cell + 1] == PARENT_UNVISITED)
+            dirs[n++] = Dir::East;
+        if (y + 1 < y1 && parents[cell + w] == PARENT_UNVISITED)
+            dirs[n++] = Dir::North;
+        if (x > x0 && parents[cell - 1] == PARENT_UNVISITED)
+            dirs[n++] = Dir::West;
+        if (y > y0 && parents[cell - w] == PARENT_UNVISITED)
+            dirs[n++] = Dir::South;
+
+        if (n == 0) {
+            // Dead end, backtrack to parent or finish at the root
+            if (parents[cell] == PARENT_ROOT)
+                break;
+            step((Dir) (parents[cell] - 1), w, x, y, cell);
+            continue;
+        }
+
+        Dir d = dirs[n == 1 ? 0 : rng.below(n)];
+        grid.carve(x, y, d);
+        step(d, w, x, y, cell);
+        parents[cell] = 1 + (uint8_t) opposite(d);
+    }
+}
+
+// Shuffle every east/north wall inside the rectangle, then knock each down
+// if the cells either side are not yet connected
+static void carveKruskal(WallGrid& grid, Random& rng,
+                         int x0, int y0, int x1, int y1) {
+    const int w = x1 - x0;
+    const int h = y1 - y0;
+    // Edge e is the east (even) or north (odd) wall of local cell e/2
+    std::vector<uint32_t> edges;
+    edges.reserve((size_t) w * h * 2);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            uint32_t c = (uint32_t) (y * w + x);
+            if (x + 1 < w)
+                edges.push_back(c * 2);
+            if (y + 1 < h)
+                edges.push_back(c * 2 + 1);
+        }
+    }
+    for (size_t i = edges.size(); i > 1; --i)
+        std::swap(edges[i - 1], edges[rng.below((uint32_t) i)]);
+
+    DisjointSets sets((size_t) w * h);
+    size_t remaining = (size_t) w * h - 1;
+    for (size_t i = 0; i < edges.size() && remaining > 0; ++i) {
+        uint32_t c = edges[i] / 2;
+        bool north = edges[i] & 1;
+        if (!sets.join(c, north ? c + w : c + 1))
+            continue;
+        grid.carve(x0 + c % w, y0 + c / w, north ? Dir::North : Dir::East);
+        --remaining;
+    }
+}
+
+// Randomised Prim's - grow the maze from a random cell, each step joining
+// a random frontier cell to a random neighbour already in the maze
+static void carvePrim(WallGrid& grid, uint8_t* scratch, Random& rng,
+                      int x0, int y0, int x1, int y1) {
+    const int w = grid.getCellsW();
+    for (int y = y0; y < y1; ++y)
+        std::fill(scratch + (size_t) y * w + x0,
+                  scratch + (size_t) y * w + x1, PARENT_UNVISITED);
+
+    std::vector<uint32_t> frontier;
+    auto push = [&](uint32_t c) {
+        if (scratch[c] == PARENT_UNVISITED) {
+            scratch[c] = FRONTIER;
+            frontier.push_back(c);
+        }
+    };
+    auto add = [&](int x, int y) {
+        uint32_t c = (uint32_t) y * w + x;
+        scratch[c] = IN_MAZE;
+        if (x + 1 < x1)
+            push(c + 1);
+        if (y + 1 < y1)
+            push(c + w);
+        if (x > x0)
+            push(c - 1);
+        if (y > y0)
+            push(c - w);
+    };
+
+    add(x0 + rng.below(x1 - x0), y0 + rng.below(y1 - y0));
+    while (!frontier.empty()) {
+        size_t i = rng.below((uint32_t) frontier.size());
+        uint32_t c = frontier[i];
+        frontier[i] = frontier.back();
+        frontier.pop_back();
+
+        int x = c % w, y = c / w;
+        Dir dirs[4];
+        int n = 0;
+        if (x + 1 < x1 && scratch[c + 1] == IN_MAZE)
+            dirs[n++] = Dir::East;
+        if (y + 1 < y1 && scratch[c + w] == IN_MAZE)
+            dirs[n++] = Dir::North;
+        if (x > x0 && scratch[c - 1] == IN_MAZE)
+            dirs[n++] = Dir::West;
+        if (y > y0 && scratch[c - w] == IN_MAZE)
+            dirs[n++] = Dir::South;
+        grid.carve(x, y, dirs[n == 1 ? 0 : rng.below(n)]);
+        add(x, y);
+    }
+}
+
+// Wilson's - loop-erased random walks from each cell not yet in the maze
+// until they hit it. Slow to start but unbiased. While walking, scratch
+// holds 1 + the direction last left each cell by, so loops erase
+// themselves by being overwritten.
+static void carveWilson(WallGrid& grid, uint8_t* scratch, Random& rng,
+                        int x0, int y0, int x1, int y1) {
+    const int w = grid.getCellsW();
+    for (int y = y0; y < y1; ++y)
+        std::fill(scratch + (size_t) y * w + x0,
+                  scratch + (size_t) y * w + x1, PARENT_UNVISITED);
+
+    scratch[(size_t) (y0 + rng.below(y1 - y0)) * w + x0 +
+            rng.below(x1 - x0)] = IN_MAZE;
+    for (int sy = y0; sy < y1; ++sy) {
+        for (int sx = x0; sx < x1; ++sx) {
+            size_t cell = (size_t) sy * w + sx;
+            if (scratch[cell] == IN_MAZE)
+                continue;
+
+            int x = sx, y = sy;
+            while (scratch[cell] != IN_MAZE) {
+                Dir dirs[4];
+                int n = 0;
+                if (x + 1 < x1)
+                    dirs[n++] = Dir::East;
+                if (y + 1 < y1)
+                    dirs[n++] = Dir::North;
+                if (x > x0)
+                    dirs[n++] = Dir::West;
+                if (y > y0)
+                    dirs[n++] = Dir::South;
+                Dir d = dirs[rng.below(n)];
+                scratch[cell] = 1 + (uint8_t) d;
+                step(d, w, x, y, cell);
+            }
+
+            // Retrace the loop-erased walk, adding it to the maze
+            x = sx, y = sy, cell = (size_t) sy * w + sx;
+            while (scratch[cell] != IN_MAZE) {
+                Dir d = (Dir) (scratch[cell] - 1);
+                grid.carve(x, y, d);
+                scratch[cell] = IN_MAZE;
+                step(d, w, x, y, cell);
+            }
+        }
+    }
+}
+
+// Sidewinder - each row is split into random east-running passages, each
+// opening north from one random cell. The top row is one long passage.
+static void carveSidewinder(WallGrid& grid, Random& rng,
+                            int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        int runStart = x0;
+        for (int x = x0; x < x1; ++x) {
+            bool closeRun = x + 1 == x1 || (y + 1 < y1 && rng.below(2));
+            if (!closeRun) {
+                grid.carve(x, y, Dir::East);
+            } else if (y + 1 < y1) {
+                grid.carve(runStart + rng.below(x - runStart + 1), y,
+                           Dir::North);
+                runStart = x + 1;
+            }
+        }
+    }
+}
+
+// Binary tree - every cell opens either north or east
+static void carveBinaryTree(WallGrid& grid, Random& rng,
+                            int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            bool canNorth = y + 1 < y1;
+            bool canEast = x + 1 < x1;
+            if (canNorth && (!canEast || rng.below(2)))
+                grid.carve(x, y, Dir::North);
+            else if (canEast)
+                grid.carve(x, y, Dir::East);
+        }
+    }
+}
+
+void carveRegion(Algorithm a, WallGrid& grid, uint8_t* scratch, Random& rng,
+                 int x0, int y0, int x1, int y1) {
+    switch (a) {
+        case Algorithm::Kruskal:
+            carveKruskal(grid, rng, x0, y0, x1, y1);
+            break;
+        case Algorithm::Prim:
+            carvePrim(grid, scratch, rng, x0, y0, x1, y1);
+            break;
+        case Algorithm::Wilson:
+            carveWilson(grid, scratch, rng, x0, y0, x1, y1);
+            break;
+        case Algorithm::Sidewinder:
+            carveSidewinder(grid, rng, x0, y0, x1, y1);
+            break;
+        case Algorithm::BinaryTree:
+            carveBinaryTree(grid, rng, x0, y0, x1, y1);
+            break;
+        default:
+            carveBacktracker(grid, scratch, rng, x0, y0, x1, y1, x0, y0);
+            break;
+    }
+}
+
+// Same walk as the backtracker, but through existing passages only and
+// without any randomness
+void solveFrom(const WallGrid& grid, uint8_t* parents,
+               int startX, int startY) {
+    const int w = grid.getCellsW();
+    std::fill(parents, parents + (size_t) w * grid.getCellsH(),
+              PARENT_UNVISITED);
+
+    static const Dir DIRS[] = {Dir::East, Dir::North, Dir::West, Dir::South};
+    int x = startX, y = startY;
+    size_t cell = (size_t) y * w + x;
+    parents[cell] = PARENT_ROOT;
+    for (;;) {
+        bool moved = false;
+        for (Dir d : DIRS) {
+            if (!grid.open(x, y, d))
+                continue;
+            int nx = x, ny = y;
+            size_t next = cell;
+            step(d, w, nx, ny, next);
+            if (parents[next] != PARENT_UNVISITED)
+                continue;
+            x = nx, y = ny, cell = next;
+            parents[cell] = 1 + (uint8_t) opposite(d);
+            moved = true;
+            break;
+        }
+        if (moved)
+            continue;
+        if (parents[cell] == PARENT_ROOT)
+            break;
+        step((Dir) (parents[cell] - 1), w, x, y, cell);
+    }
+}
+
+// Boundaries of n slices of [0, size), aligned to the WallGrid's 8 cell
+// blocks so no two threads ever write to the same word
+static std::vector<int> slices(int size, int n) {
+    std::vector<int> bounds(n + 1);
+    for (int i = 0; i < n; ++i)
+        bounds[i] = (int) ((long long) size * i / n) & ~7;
+    bounds[n] = size;
+    return bounds;
+}
+
+void carvePartitioned(Algorithm a, WallGrid& grid, uint8_t* scratch,
+                      uint64_t seed, int threads) {
+    const int w = grid.getCellsW();
+    const int h = grid.getCellsH();
+
+    // Pick a layout of regions closest to square, not smaller than
+    // MIN_REGION on either side
+    int regionsX = 1, regionsY = 1;
+    float bestScore = 0.0f;
+    for (int n = std::max(1, threads); n >= 1 && bestScore == 0.0f; --n) {
+        for (int rx = 1; rx <= n; ++rx) {
+            if (n % rx != 0)
+                continue;
+            int ry = n / rx;
+            if (w / rx < MIN_REGION || h / ry < MIN_REGION)
+                continue;
+            float aspect = ((float) w / rx) / ((float) h / ry);
+            float score = std::min(aspect, 1.0f / aspect);
+            if (score > bestScore) {
+                bestScore = score;
+                regionsX = rx;
+                regionsY = ry;
+            }
+        }
+    }
+
+    std::vector<int> xs = slices(w, regionsX);
+    std::vector<int> ys = slices(h, regionsY);
+    const int regions = regionsX * regionsY;
+
+    // Each region gets its own generator derived from the seed, so the
+    // result does not depend on how threads are scheduled
+    auto carve = [&](int r) {
+        Random rng(seed + 0x9E3779B97F4A7C15ull * (uint64_t) (r + 1));
+        int rx = r % regionsX, ry = r / regionsX;
+        carveRegion(a, grid, scratch, rng,
+                    xs[rx], ys[ry], xs[rx + 1], ys[ry + 1]);
+    };
+
+    std::vector<std::thread> workers;
+    for (int r = 1; r < regions; ++r)
+        workers.push_back(std::thread(carve, r));
+    carve(0);
+    for (auto& t : workers)
+        t.join();
+
+    if (regions == 1)
+        return;
+
+    // Every region is now a spanning tree of its own cells. Join them
+    // with a random spanning tree over the region grid, opening one wall
+    // along each chosen shared border.
+    struct Border {
+        int a, b;
+        bool vertical; // a is west of b, otherwise a is south of b
+    };
+    std::vector<Border> borders;
+    for (int ry = 0; ry < regionsY; ++ry) {
+        for (int rx = 0; rx < regionsX; ++rx) {
+            int r = ry * regionsX + rx;
+            if (rx + 1 < regionsX)
+                borders.push_back({r, r + 1, true});
+            if (ry + 1 < regionsY)
+                borders.push_back({r, r + regionsX, false});
+        }
+    }
+
+    Random rng(seed);
+    for (size_t i = borders.size() - 1; i > 0; --i)
+        std::swap(borders[i], borders[rng.below((uint32_t) i + 1)]);
+
+    DisjointSets sets(regions);
+    for (auto& b : borders) {
+        if (!sets.join(b.a, b.b))
+            continue;
+        int rx = b.a % regionsX, ry = b.a / regionsX;
+        if (b.vertical) {
+            int y = ys[ry] + rng.below(ys[ry + 1] - ys[ry]);
+            grid.carve(xs[rx + 1] - 1, y, Dir::East);
+        } else {
+            int x = xs[rx] + rng.below(xs[rx + 1] - xs[rx]);
+            grid.carve(x, ys[ry + 1] - 1, Dir::North);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+/*
+ * Generator - maze carving algorithms working directly on a WallGrid.
+ *
+ * Every algorithm carves a perfect maze (spanning tree) over a rectangle
+ * of cells, so any of them can also be used per region by the
+ * partitioned generator. They take a scratch array of one byte per cell
+ * (indexed y*W + x, the same as the parents array solveFrom fills), and
+ * all randomness comes from the Random passed in, so a maze is fully
+ * determined by its seed.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "wall_grid.h"
+#include "random.h"
+
+enum class Algorithm {
+    Backtracker, // Randomised DFS - long winding corridors
+    Kruskal,     // Random edges joined with union-find - many short dead ends
+    Prim,        // Growing frontier - short, branchy passages
+    Wilson,      // Loop-erased random walks - uniform spanning tree
+    Sidewinder,  // Row by row runs - long clear top row
+    BinaryTree,  // North or east per cell - strong diagonal bias
+    Count
+};
+
+const char* algorithmName(Algorithm a);
+// Returns false if name is not one of the algorithm names
+bool parseAlgorithm(const std::string& name, Algorithm& a);
+
+static const uint8_t PARENT_UNVISITED = 0;
+static const uint8_t PARENT_ROOT = 0xFF;
+
+// Carve the cells [x0, x1) x [y0, y1) with the given algorithm. The
+// backtracker starts from (x0, y0), so leaves a parents tree rooted
+// there, every other algorithm leaves scratch in an unspecified state.
+void carveRegion(Algorithm a, WallGrid& grid, uint8_t* scratch, Random& rng,
+                 int x0, int y0, int x1, int y1);
+
+// Randomised DFS (recursive backtracker) within the cells
+// [x0, x1) x [y0, y1), starting from (startX, startY)
+void carveBacktracker(WallGrid& grid, uint8_t* parents, Random& rng,
+                      int x0, int y0, int x1, int y1,
+                      int startX, int startY);
+
+// Split the grid into one region per thread, carve each region on its
+// own thread then join the regions into a single spanning tree. Small
+// mazes use fewer regions. Deterministic for a given seed and thread
+// count. Leaves scratch in an unspecified state.
+void carvePartitioned(Algorithm a, WallGrid& grid, uint8_t* scratch,
+                      uint64_t seed, int threads);
+
+// Fill parents with the tree of existing passages rooted at
+// (startX, startY)
+void solveFrom(const WallGrid& grid, uint8_t* parents,
+               int startX, int startY);
+
+#endif
@@ -9,13 +9,18 @@
 
 #include <iostream>
 #include <map>
-#include "input.h"
+#include "glut_input.h"
 
 static std::map<unsigned char, bool> keys;
 static std::map<unsigned char, bool> just;
 static std::map<Mouse, bool> mouseButtons;
 static glm::vec2 mousePos;
 static glm::vec2 mouseOffset;
+static int scroll;
+
+// GLUT reports the wheel as presses of two more buttons
+static const int WHEEL_UP = 3;
+static const int WHEEL_DOWN = 4;
 
 static void keyCallback(unsigned char key, int x, int y) {
     if (!keys[key]) {
@@ -40,6 +45,12 @@ static void mouseCallback(int button, int state, int x, int y) {
         case GLUT_MIDDLE_BUTTON:
             mouseButtons[Mouse::Middle] = !state;
             break;
+        case WHEEL_UP:
+            scroll += state == GLUT_DOWN;
+            break;
+        case WHEEL_DOWN:
+            scroll -= state == GLUT_DOWN;
+            break;
         default: break;
     }
 }
@@ -53,37 +64,42 @@ static void mouseMoveCallback(int x, int y) {
     }
 }
 
-bool Input::getKey(unsigned char key) {
+bool GlutInput::getKey(unsigned char key) {
     return keys[key];
 }
 
-bool Input::getJust(unsigned char key) {
+bool GlutInput::getJust(unsigned char key) {
     bool result = just[key];
     just[key] = false;
     return result;
 }
 
-bool Input::getBtn(Mouse btn) {
+bool GlutInput::getBtn(Mouse btn) {
     return mouseButtons[btn];
 }
 
-bool Input::hasMoved() {
+bool GlutInput::hasMoved() {
     return mouseOffset.x != 0 || mouseOffset.y != 0;
 }
 
-glm::vec2 Input::getMousePos() {
+glm::vec2 GlutInput::getMousePos() {
     return mousePos;
 }
 
-// Returns mouse movement since this was last called
 // (0, 0) is top left corner
-glm::vec2 Input::getMovement() {
+glm::vec2 GlutInput::getMovement() {
     glm::vec2 offset = mouseOffset;
     mouseOffset = glm::vec2();
     return offset;
 }
 
-Input::Input() {
+int GlutInput::getScroll() {
+    int notches = scroll;
+    scroll = 0;
+    return notches;
+}
+
+GlutInput::GlutInput() {
     int cX = glutGet(GLUT_WINDOW_WIDTH) / 2;
     int cY = glutGet(GLUT_WINDOW_HEIGHT) / 2;
     glutWarpPointer(cX, cY);
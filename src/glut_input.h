@@ -0,0 +1,25 @@
+#ifndef GLUT_INPUT_H
+#define GLUT_INPUT_H
+
+/*
+ * GlutInput - small class to wrap GLUT's input. Needs a window, the
+ * pointer is kept warped to the middle of it.
+ */
+
+#include "input.h"
+
+class GlutInput : public Input {
+public:
+    GlutInput();
+    ~GlutInput() {}
+
+    bool getKey(unsigned char key);
+    bool getJust(unsigned char key);
+    bool getBtn(Mouse btn);
+    bool hasMoved();
+    glm::vec2 getMousePos();
+    glm::vec2 getMovement();
+    int getScroll();
+};
+
+#endif
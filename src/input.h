@@ -2,9 +2,12 @@
 #define INPUT_H
 
 /*
- * Input - small class to wrap GLUT's input
+ * Input - what the game reads of the keyboard and mouse. GlutInput reads
+ * GLUT's, ScriptedInput is driven by code, for running without a window.
  */
 
+#include <glm/glm.hpp>
+
 enum class Mouse : int {
     Left,
     Right,
@@ -13,18 +16,18 @@ enum class Mouse : int {
 
 class Input {
 public:
-    Input();
-    ~Input() {}
-
-    bool getKey(unsigned char key);  // If a key is pressed
-    bool getJust(unsigned char key); // If a key has just been pressed
-    bool getBtn(Mouse btn);          // Mouse button state
-    bool hasMoved();                 // Mouse movement state
-    glm::vec2 getMousePos();
-    glm::vec2 getMovement();
+    virtual ~Input() {}
 
-private:
-    glm::vec2 lastMousePos;
+    virtual bool getKey(unsigned char key) = 0;  // If a key is pressed
+    virtual bool getJust(unsigned char key) = 0; // If a key has just been
+                                                 // pressed
+    virtual bool getBtn(Mouse btn) = 0;          // Mouse button state
+    virtual bool hasMoved() = 0;                 // Mouse movement state
+    virtual glm::vec2 getMousePos() = 0;
+    // Mouse movement since this was last called, in pixels
+    virtual glm::vec2 getMovement() = 0;
+    // Wheel notches since this was last called, up is positive
+    virtual int getScroll() = 0;
 };
 
 #endif
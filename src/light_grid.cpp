@@ -0,0 +1,61 @@
+#include "light_grid.h"
+
+#include <algorithm>
+
+// Ints before the first cell's range
+static const int HEADER = 6;
+
+void LightGrid::build(const std::vector<PointLight>& lights, glm::ivec2 lo,
+                      glm::ivec2 hi) {
+    const int countX = std::max(1, (hi.x - lo.x + cellTiles - 1) / cellTiles);
+    const int countY = std::max(1, (hi.y - lo.y + cellTiles - 1) / cellTiles);
+    cells.assign(HEADER + 2 * countX * countY, 0);
+    cells[0] = lo.x;
+    cells[1] = lo.y;
+    cells[2] = countX;
+    cells[3] = countY;
+    cells[4] = cellTiles;
+    int32_t* ranges = &cells[HEADER];
+
+    // Cells each light's box covers, clamped to the grid. Empty if the
+    // light is off it altogether.
+    auto covered = [&](const PointLight& l, glm::ivec2& first,
+                       glm::ivec2& last) {
+        glm::vec2 p(l.pos.x, l.pos.y);
+        glm::ivec2 a = glm::ivec2(glm::floor(p - l.radius)) - lo;
+        glm::ivec2 b = glm::ivec2(glm::floor(p + l.radius)) - lo;
+        if (b.x < 0 || b.y < 0)
+            return false;
+        first = glm::max(a, glm::ivec2(0)) / cellTiles;
+        last = glm::min(b / cellTiles, glm::ivec2(countX - 1, countY - 1));
+        return last.x >= first.x && last.y >= first.y;
+    };
+
+    // Count per cell, turn counts into offsets, then drop each light's
+    // id in every cell it covers
+    glm::ivec2 first, last;
+    for (const PointLight& l : lights) {
+        if (!covered(l, first, last))
+            continue;
+        for (int y = first.y; y <= last.y; ++y)
+            for (int x = first.x; x <= last.x; ++x)
+                ++ranges[2 * (y * countX + x) + 1];
+    }
+    uint32_t total = 0;
+    for (int c = 0; c < countX * countY; ++c) {
+        ranges[2 * c] = total;
+        total += ranges[2 * c + 1];
+        ranges[2 * c + 1] = 0;
+    }
+    indices.resize(total);
+    for (size_t i = 0; i < lights.size(); ++i) {
+        if (!covered(lights[i], first, last))
+            continue;
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                int32_t* r = &ranges[2 * (y * countX + x)];
+                indices[r[0] + r[1]++] = i;
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+/*
+ * LightGrid - bins point lights into square cells of the maze's tile
+ * grid, so the maze shader only has to shade the lights whose reach
+ * overlaps the cell a fragment is in.
+ *
+ * Cells only cover the tiles asked for, so their number doesn't grow
+ * with the maze: the renderer asks for those around the camera that can
+ * be seen, with some to spare, and rebins as lights are added or the
+ * camera nears the edge. Cells are built with a counting sort into one
+ * index list.
+ */
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// As laid out in the shader's std430 light buffer
+struct PointLight {
+    glm::vec3 pos;
+    float radius; // Tiles, nothing past it is lit
+    glm::vec3 color;
+    float pad;
+};
+
+class LightGrid {
+public:
+    // Cells cellTiles tiles to a side
+    LightGrid(int cellTiles) : cellTiles(cellTiles) {}
+
+    // Bin lights over the tiles in [lo, hi)
+    void build(const std::vector<PointLight>& lights, glm::ivec2 lo,
+               glm::ivec2 hi);
+
+    /* Header then cell ranges, as the shader's std430 cell buffer: *
+     * origin tile (2 ints), cells across and up (2 ints), tiles     *
+     * per cell, padding, then first index and count per cell        */
+    const std::vector<int32_t>& getCells() const { return cells; }
+    // Light ids, cell by cell
+    const std::vector<uint32_t>& getIndices() const { return indices; }
+
+private:
+    int cellTiles;
+    std::vector<int32_t> cells;
+    std::vector<uint32_t> indices;
+};
+
+#endif
@@ -1,52 +1,339 @@
 #include <iostream>
 #include <string>
 #include <cctype>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <time.h>
 
 #include "window.h"
 #include "world.h"
 #include "renderer.h"
+#include "settings.h"
+#include "glut_input.h"
+#include "offscreen.h"
+#include "scripted_input.h"
+#include "random.h"
 
 /* Doesn't do much, everything is handled in the other files */
 
 static const int WIDTH = 1920;
 static const int HEIGHT = 1080;
+// Ticks between the wandering player picking a new way to turn, and the
+// most it turns by a tick, in pixels of mouse movement
+static const int WANDER_TICKS = 30;
+static const int WANDER_TURN = 20;
+// Moving less than this many tiles a second, a fifth of walking speed,
+// the wandering player is stuck against a wall and turns away from it by
+// a quarter to a half turn (in pixels, at the camera's 0.001 radians
+// a pixel)
+static const float WANDER_STUCK = 0.3f;
+static const int WANDER_AWAY_MIN = 1571;
+static const int WANDER_AWAY_MAX = 3142;
 
 void print_usage() {
     std::cout << "Please give 0 or 2 arguments: 0 for default "
         << "size maze, 2 to specify width & height of maze. " 
-        << "Non-square mazes work fine. 20x20 maze by default."
-        << "\n\n./maze width height\n"
+        << "Non-square mazes work fine. 10x10 maze by default."
+        << "\n\n./maze [width height] [options]\n"
         << "\twidth: integer - width of maze (>= 1)\n"
-        << "\theight: integer - height of maze (>= 1)\n\n";
+        << "\theight: integer - height of maze (>= 1)\n\n"
+        << "Options:\n"
+        << "\t--algorithm name: maze generator, one of\n\t\t";
+    for (int i = 0; i < (int) Algorithm::Count; ++i)
+        std::cout << algorithmName((Algorithm) i) << ' ';
+    std::cout << "\n\t\t(backtracker by default)\n"
+        << "\t--seed n: 64-bit seed, to reproduce a maze exactly "
+        << "(random by default)\n"
+        << "\t--threads n: generate in n regions in parallel "
+        << "(1 by default, more leave seams along region borders)\n"
+        << "\t--endless: endless maze generated around the player as "
+        << "they walk, size and algorithm are ignored\n"
+        << "\t--tick-rate n: simulation ticks per second "
+        << "(60 by default)\n"
+        << "\t--view-distance n: how many tiles away the maze is drawn, "
+        << "[ and ] change it while playing (10 by default)\n"
+        << "\t--pvs: work out what can be seen from each tile when a maze "
+        << "is made and only draw that, slow for big mazes\n"
+        << "\t--stats: print timings and counts as the maze is baked "
+        << "and drawn\n"
+        << "\t--torches n: light n random spots of the maze with torches "
+        << "(0 by default, not for endless mazes)\n"
+        << "\t--target-fps n: draw the maze at a lower resolution when "
+        << "frames are too slow for n per second (off by default)\n"
+        << "\t--headless: no window, tick the world as fast as possible "
+        << "with the player wandering and report ticks per second\n"
+        << "\t--ticks n: how many ticks to run headless "
+        << "(100000 by default)\n"
+        << "\t--offscreen: no window, draw frames offscreen through EGL "
+        << "as fast as possible, a tick each, and report frames per "
+        << "second\n"
+        << "\t--frames n: how many frames to draw offscreen "
+        << "(300 by default)\n"
+        << "\t--camera-path file: lines of \"x y yaw\" to place the "
+        << "player at each offscreen frame, yaw in degrees anticlockwise "
+        << "from north, repeating (wanders as headless otherwise)\n"
+        << "\t--out dir: write offscreen frames into dir as "
+        << "frame_00000.ppm... (thrown away otherwise)\n\n";
     exit(EXIT_FAILURE);
 }
 
+// Where the wandering player was and which way it is turning
+struct Wander {
+    Wander(const Settings& s) : rng(s.seed), turn(0.0f), tick(0),
+        stuck(WANDER_STUCK / s.tickRate) {}
+
+    Random rng;
+    float turn;
+    long tick;
+    float stuck; // Tiles a tick
+    glm::vec2 last;
+};
+
+// Walk the player forwards, picking a new way to turn every
+// WANDER_TICKS ticks, and turning sharply to a random side whenever the
+// last tick got it nowhere (head on into a wall or at a dead end)
+static void wander(ScriptedInput& input, World& world, Wander& w) {
+    const glm::vec2 pos = world.getPos();
+    input.press('w');
+    if (w.tick > 0 && glm::length(pos - w.last) < w.stuck) {
+        float away = WANDER_AWAY_MIN +
+            w.rng.below(WANDER_AWAY_MAX - WANDER_AWAY_MIN + 1);
+        input.move(glm::vec2(w.rng.below(2) ? away : -away, 0.0f));
+        w.turn = 0.0f;
+    } else {
+        if (w.tick % WANDER_TICKS == 0)
+            w.turn = (float) w.rng.below(2*WANDER_TURN + 1) - WANDER_TURN;
+        input.move(glm::vec2(w.turn, 0.0f));
+    }
+    w.last = pos;
+    ++w.tick;
+}
+
+// How many of what were done in time, and how many a second
+static void printRate(long count, const char* what,
+                      std::chrono::steady_clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    std::cout << count << ' ' << what << " in " << seconds << "s, "
+        << (long) (count / seconds) << ' ' << what << "/s\n";
+}
+
+// Tick the world with no window or GL, the player wandering, reporting
+// ticks per second every second and at the end
+static void runHeadless(const Settings& settings) {
+    typedef std::chrono::steady_clock Clock;
+    ScriptedInput input;
+    World world(WIDTH, HEIGHT, settings, input);
+    Wander w(settings);
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point reported = start;
+    long reportedTicks = 0;
+    for (long t = 0; t < settings.ticks; ++t) {
+        wander(input, world, w);
+        world.tick();
+        const Clock::time_point now = Clock::now();
+        if (now - reported >= std::chrono::seconds(1)) {
+            printRate(t + 1 - reportedTicks, "ticks", now - reported);
+            reported = now;
+            reportedTicks = t + 1;
+        }
+    }
+    std::cout << "Total: ";
+    printRate(settings.ticks, "ticks", Clock::now() - start);
+}
+
+// Camera path of (x, y, yaw in radians), false if the file can't be read
+static bool loadPath(const std::string& file,
+                     std::vector<glm::vec3>& path) {
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        glm::vec3 p;
+        if (fields >> p.x >> p.y >> p.z)
+            path.push_back({p.x, p.y, glm::radians(p.z)});
+    }
+    return !path.empty();
+}
+
+static bool writePPM(const std::string& file, int w, int h,
+                     const std::vector<unsigned char>& pixels) {
+    std::ofstream out(file, std::ios::binary);
+    out << "P6\n" << w << ' ' << h << "\n255\n";
+    out.write((const char*) pixels.data(), pixels.size());
+    return (bool) out;
+}
+
+// Draw frames into an offscreen context with no window or display, a
+// tick of the world before each, reporting frames per second at the end
+static int runOffscreen(const Settings& settings) {
+    typedef std::chrono::steady_clock Clock;
+    std::vector<glm::vec3> path;
+    if (!settings.cameraPath.empty() &&
+        !loadPath(settings.cameraPath, path)) {
+        std::cerr << "Couldn't read a camera path from "
+            << settings.cameraPath << '\n';
+        return EXIT_FAILURE;
+    }
+    Offscreen context;
+    if (!context.init())
+        return EXIT_FAILURE;
+    ScriptedInput input;
+    World world(WIDTH, HEIGHT, settings, input);
+    Renderer& renderer = Renderer::getInstance();
+    renderer.startOffscreen(&world, WIDTH, HEIGHT);
+    Wander w(settings);
+
+    const bool write = !settings.outDir.empty();
+    std::vector<unsigned char> pixels;
+    const Clock::time_point start = Clock::now();
+    for (int f = 0; f < settings.frames; ++f) {
+        if (path.empty()) {
+            wander(input, world, w);
+        } else {
+            const glm::vec3& p = path[f % path.size()];
+            world.placeCamera(glm::vec2(p), p.z);
+        }
+        world.tick();
+        // Frames are as far apart as ticks, so they come out the same
+        // however fast they are drawn
+        renderer.drawOffscreen(1000.0f * f / settings.tickRate,
+                               write ? &pixels : NULL);
+        if (!write)
+            continue;
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%05d.ppm", f);
+        if (!writePPM(settings.outDir + name, WIDTH, HEIGHT, pixels)) {
+            std::cerr << "Couldn't write " << settings.outDir + name
+                << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    printRate(settings.frames, "frames", Clock::now() - start);
+    return 0;
+}
+
+// Whole string must be a number, otherwise usage is printed
+static unsigned long long parseNumber(const std::string& str) {
+    std::string::size_type end;
+    if (str.empty() || !isdigit(str[0]))
+        print_usage();
+    unsigned long long n = 0;
+    try {
+        n = std::stoull(str, &end);
+    } catch (std::exception& e) {
+        print_usage();
+    }
+    if (end != str.length())
+        print_usage();
+    return n;
+}
+
 int main(int argc, char** argv) {
-    int mazeW, mazeH;
-    {   // Scope so s1, s2 don't pollute memory entire time
-        std::string::size_type s1, s2;
-        switch (argc) {
-            case 1:
-                mazeW = mazeH = 10;
-                break;
-            case 3:
-                if (!isdigit(argv[1][0]) || !isdigit(argv[2][0]))
+    Settings settings;
+    settings.seed = (uint64_t) time(0);
+
+    {   // Scope so argument strings don't pollute memory entire time
+        std::vector<std::string> sizes;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                sizes.push_back(arg);
+                continue;
+            }
+            if (arg == "--endless") {
+                settings.endless = true;
+                continue;
+            }
+            if (arg == "--pvs") {
+                settings.pvs = true;
+                continue;
+            }
+            if (arg == "--stats") {
+                settings.stats = true;
+                continue;
+            }
+            if (arg == "--headless") {
+                settings.headless = true;
+                continue;
+            }
+            if (arg == "--offscreen") {
+                settings.offscreen = true;
+                continue;
+            }
+            if (i + 1 >= argc)
+                print_usage();
+            std::string value = argv[++i];
+            if (arg == "--algorithm") {
+                if (!parseAlgorithm(value, settings.algorithm))
                     print_usage();
-                mazeW = std::stoi(std::string(argv[1]), &s1);
-                mazeH = std::stoi(std::string(argv[2]), &s2);
-                if     (s1 != std::string(argv[1]).length() ||
-                        s2 != std::string(argv[2]).length() ||
-                        mazeW <= 1 ||
-                        mazeH <= 1)
+            } else if (arg == "--seed") {
+                settings.seed = parseNumber(value);
+            } else if (arg == "--tick-rate") {
+                settings.tickRate = (int) parseNumber(value);
+                if (settings.tickRate < 1 || settings.tickRate > 1000)
+                    print_usage();
+            } else if (arg == "--view-distance") {
+                settings.viewDistance = (float) parseNumber(value);
+                if (settings.viewDistance < 1)
+                    print_usage();
+            } else if (arg == "--target-fps") {
+                settings.targetFps = (int) parseNumber(value);
+            } else if (arg == "--ticks") {
+                settings.ticks = (long) parseNumber(value);
+            } else if (arg == "--frames") {
+                settings.frames = (int) parseNumber(value);
+            } else if (arg == "--camera-path") {
+                settings.cameraPath = value;
+            } else if (arg == "--out") {
+                settings.outDir = value;
+            } else if (arg == "--torches") {
+                settings.torches = (int) parseNumber(value);
+            } else if (arg == "--threads") {
+                settings.threads = (int) parseNumber(value);
+                if (settings.threads < 1)
+                    print_usage();
+            } else {
+                print_usage();
+            }
+        }
+
+        switch (sizes.size()) {
+            case 0:
+                break;
+            case 2:
+                settings.mazeW = (int) parseNumber(sizes[0]);
+                settings.mazeH = (int) parseNumber(sizes[1]);
+                if (settings.mazeW <= 1 || settings.mazeH <= 1)
                     print_usage();
                 break;
             default: print_usage();
         }
     }
 
+    if (settings.endless)
+        std::cout << "Endless maze, seed " << settings.seed << '\n';
+    else
+        std::cout << "Generating " << settings.mazeW << "x" << settings.mazeH
+            << " maze with " << algorithmName(settings.algorithm)
+            << ", seed " << settings.seed
+            << ", " << settings.threads << " thread(s)\n";
+
+    if (settings.headless) {
+        runHeadless(settings);
+        return 0;
+    }
+    if (settings.offscreen)
+        return runOffscreen(settings);
+
     Window window(WIDTH, HEIGHT);
     window.init(&argc, argv);
-    World world(WIDTH, HEIGHT, mazeW, mazeH);
+    GlutInput input;
+    World world(WIDTH, HEIGHT, settings, input);
     // Renderer is singleton because GLUT, initialised/started here
     Renderer::getInstance().start(&world, WIDTH, HEIGHT);
     return 0;
@@ -1,179 +1,288 @@
 #include "maze.h"
 
-#include <stack>
 #include <cstdlib>
-#include <iostream>
-#include <utility>
 #include <cmath>
-#include <time.h>
+#include <cassert>
+#include <algorithm>
 
-Maze::Maze(int width, int height) {
-    srand((long) time(0));
-    tiles.resize(width*2 + 1);
-    for (int i = 0; i < tiles.size(); i++)
-        tiles[i].resize(height*2 + 1);
+Maze::Maze(int width, int height, Algorithm algorithm, uint64_t seed,
+           int threads, bool endless) :
+        builds(0), algorithm(algorithm), threads(threads) {
+    rng.seed(seed);
+    if (endless) {
+        chunks.reset(new ChunkCache(seed));
+        end = {-1, -1};
+        winState = false;
+        return;
+    }
+    grid.resize(width, height);
+    parents.resize((size_t) width * height);
 
     build();
 }
 
 void Maze::build() {
-    for (int i = 0; i < tiles.size(); i++)
-        for (int j = 0; j < tiles[i].size(); j++)
-            tiles[i][j].type = Type::Wall;
-
-    end = {tiles.size() - 2, tiles[0].size() - 2};
-    tiles[1][1].type = Type::Entrance;
-    tiles[end.x][end.y].type = Type::Exit;
+    grid.fill();
+    ++builds;
+    end = {grid.getWidth() - 2, grid.getHeight() - 2};
 
     winState = false;
     exitFound = false;
-    DFS(1, 1);
-
-    // Put optimal path into maze grid as found by DFS
-    auto exit = glm::ivec2(tiles.size() - 2, tiles[0].size() - 2);
-    auto entrance = glm::ivec2(1, 1);
-    auto& current = exit;
-    blendAdjacent(current, path[current], Type::Path);
-    current = path[current];
-    while (current != entrance) {
-        tiles[current.x][current.y].type = Type::Path;
-        blendAdjacent(current, path[current], Type::Path);
-        current = path[current];
-    }
-    path.clear();
-
-    // Construct collision mesh
-    // For every cube, find the side faces that do not face other tiles
-    // Four faces per cube to be considered
-    // Up vector is Z.
-    faceLookup.clear();
-    Tile *t, *facing;
-    Face f;
-    int s;
-    for (int i = 0; i < tiles.size(); ++i) { 
-        for (int j = 0; j < tiles[0].size(); ++j) {
-            if (tiles[i][j].type != Type::Wall)
-                continue;
-            t = &tiles[i][j];
-
-            if (i > 0)
-                addFace(i, j, -1, 0);
-            if (j > 0)
-                addFace(i, j, 0, -1);
-            if (i < tiles.size() - 1)
-                addFace(i, j, 1, 0);
-            if (j < tiles[i].size() - 1)
-                addFace(i, j, 0, 1);
-        }
-    }
+    // Partitioned generation leaves seams along region borders, so only
+    // used when asked for more than one thread
+    if (threads > 1)
+        carvePartitioned(algorithm, grid, parents.data(), rng.next(), threads);
+    else
+        carveRegion(algorithm, grid, parents.data(), rng,
+                    0, 0, grid.getCellsW(), grid.getCellsH());
+    // Backtracker run from the entrance already leaves the tree of paths
+    // back to it, anything else has to find it
+    if (threads > 1 || algorithm != Algorithm::Backtracker)
+        solveFrom(grid, parents.data(), 0, 0);
+    markPath(grid.getCellsW() - 1, grid.getCellsH() - 1);
 }
 
-// Add face to collision mesh given its x/y offsets from the center
-// tile (tX, tY)
-void Maze::addFace(int tX, int tY, int offX, int offY) {
-    assert(abs(offX) <= 1 && abs(offY) <= 1);
-    if (tiles[tX + offX][tY + offY].type != Type::Wall) {
-        int sX = offX > 0 ? 1 : 0;
-        int sY = offY > 0 ? 1 : 0;
-        Dir dir = offX > 0 ? Dir::East  :
-                  offY > 0 ? Dir::North :
-                  offX < 0 ? Dir::West  :
-                             Dir::South;
-        mesh.push_back({
-            glm::vec2(tX, tY),
-            glm::vec3(tX + sX, tY + sY, 0.0f),
-            glm::vec3(tX + sX + abs(offY), tY + sY + abs(offX), 0.0f),
-            glm::vec3(offX, offY, 0.0f),
-            dir
-        });
-        lookupInsert(tX + offX, tY + offY, mesh.size() - 1);
-    }
+WallGrid& Maze::getGrid() {
+    return grid;
 }
 
-TileGrid& Maze::getGrid() {
-    return tiles;
+Tile Maze::getTile(int x, int y) const {
+    if (x == 1 && y == 1)
+        return {Type::Entrance};
+    if (chunks)
+        return {chunks->type(x, y)};
+    if (x == end.x && y == end.y)
+        return {Type::Exit};
+    return {grid.type(x, y)};
 }
 
-Tile& Maze::getTile(int x, int y) {
-    return tiles[x][y];
+int Maze::getWidth() const {
+    return chunks ? chunks->getWidth() : grid.getWidth();
 }
 
-// DFS jumps 2 tiles to leave tiles to be walls. This function is
-// to set the tile inbetween the jump.
-void Maze::blendAdjacent(glm::ivec2 a, glm::ivec2 b, Type t) {
-    assert((a.x + b.x) % 2 == 0 && (a.y + b.y) % 2 == 0);
-    if (a.x != b.x) {
-        tiles[(a.x + b.x)/2][a.y].type = t;
-    } else {
-        tiles[a.x][(a.y + b.y)/2].type = t;
-    }
+int Maze::getHeight() const {
+    return chunks ? chunks->getHeight() : grid.getHeight();
 }
 
-void Maze::lookupInsert(int x, int y, int i) {
-    int key = y*tiles.size() + x;
-    if (faceLookup.find(key) == faceLookup.end()) {
-        faceLookup[key] = std::vector<int>({i});
-    } else faceLookup[key].push_back(i);
-}
-
-std::vector<int> Maze::facesAt(int x, int y) {
-    int key = y*tiles.size() + x;
-    if (faceLookup.find(key) != faceLookup.end())
-        return faceLookup[y*tiles.size() + x];
-    else return std::vector<int>();
-}
-
-// Returns vector of adjacent (north, south, east, west) tiles from
-// a given tile
-std::vector<glm::ivec2> Maze::getAdjacents(glm::ivec2 dbt) {
-        std::vector<glm::ivec2> adjacent;
-        if (dbt.x < tiles.size() - 2)
-            adjacent.push_back({dbt.x + 2, dbt.y});
-        if (dbt.y < tiles[0].size() - 2)
-            adjacent.push_back({dbt.x, dbt.y + 2});
-        if (dbt.x > 1)
-            adjacent.push_back({dbt.x - 2, dbt.y});
-        if (dbt.y > 1)
-            adjacent.push_back({dbt.x, dbt.y - 2});
-
-        std::vector<glm::ivec2> randomisedAdjacents;
-        while (!adjacent.empty()) {
-            int rNum = rand() % adjacent.size();
-            randomisedAdjacents.push_back(adjacent[rNum]);
-            adjacent.erase(adjacent.begin() + rNum);
+// Each wall next to the tile has a face towards it
+int Maze::facesAt(int x, int y, Face* out) const {
+    if (solid(x, y))
+        return 0;
+    static const int SIDES[4][2] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+    int n = 0;
+    for (const auto& side : SIDES)
+        if (solid(x + side[0], y + side[1]))
+            out[n++] = makeFace(x + side[0], y + side[1], -side[0], -side[1]);
+    return n;
+}
+
+int Maze::queryWalls(glm::vec2 center, glm::vec2 halfSize, glm::vec2 motion,
+                     WallContact* out, int capacity) const {
+    // Open tiles the swept box covers, with a tile of slack for the
+    // corrections the caller makes as it goes. Kept to a small window,
+    // a step of movement is well under a tile.
+    static const int SPAN = 16;
+    glm::vec2 lo = glm::min(center, center + motion) - halfSize;
+    glm::vec2 hi = glm::max(center, center + motion) + halfSize;
+    const int x0 = std::max(0, (int) floorf(lo.x) - 1);
+    const int y0 = std::max(0, (int) floorf(lo.y) - 1);
+    const int x1 = std::min({getWidth() - 1, (int) hi.x + 1, x0 + SPAN - 3});
+    const int y1 = std::min({getHeight() - 1, (int) hi.y + 1, y0 + SPAN - 3});
+
+    // Walls of those tiles and the ring around them
+    bool wall[SPAN][SPAN];
+    for (int y = y0 - 1; y <= y1 + 1; ++y)
+        for (int x = x0 - 1; x <= x1 + 1; ++x)
+            wall[y - y0 + 1][x - x0 + 1] = solid(x, y);
+    auto open = [&](int x, int y) {
+        return x >= x0 && x <= x1 && y >= y0 && y <= y1 &&
+            !wall[y - y0 + 1][x - x0 + 1];
+    };
+
+    int n = 0;
+    for (int y = y0 - 1; y <= y1 + 1; ++y) {
+        for (int x = x0 - 1; x <= x1 + 1 && n + 4 <= capacity; ++x) {
+            if (!wall[y - y0 + 1][x - x0 + 1])
+                continue;
+            if (open(x - 1, y))
+                out[n++] = {{-1.0f, 0.0f}, (float) x, (float) y, true};
+            if (open(x, y - 1))
+                out[n++] = {{0.0f, -1.0f}, (float) y, (float) x, false};
+            if (open(x + 1, y))
+                out[n++] = {{1.0f, 0.0f}, (float) x + 1, (float) y, true};
+            if (open(x, y + 1))
+                out[n++] = {{0.0f, 1.0f}, (float) y + 1, (float) x, false};
         }
+    }
+    return n;
+}
+
+bool Maze::solid(int x, int y) const {
+    if (x < 0 || y < 0 || x >= getWidth() || y >= getHeight())
+        return true;
+    return chunks ? chunks->type(x, y) == Type::Wall : grid.isWall(x, y);
+}
 
-        return randomisedAdjacents;
-}
-
-// Randomised iterative DFS implementation
-void Maze::DFS(int startX, int startY) {
-    std::stack<glm::ivec2> consider({{startX, startY}});
-    bool exitF = false;
-    while (!consider.empty()) {
-        auto top = consider.top();
-        consider.pop();
-        auto& tile = tiles[top.x][top.y];
-        if (tile.type == Type::Wall || tile.type == Type::Entrance) {
-            if (tile.type != Type::Entrance) {
-                blendAdjacent(top, path[top], Type::Floor);
-                tile.type = Type::Floor;
+// Casts the box's center as a ray against wall tiles grown by halfSize.
+// The ray's tiles are walked in order (a DDA) and, as the box is under a
+// tile wide, only walls next to those tiles can be hit. Stops once the
+// ray enters a tile later than the earliest hit so far.
+bool Maze::castBox(glm::vec2 center, glm::vec2 halfSize, glm::vec2 motion,
+                   float& t, glm::vec2& normal) const {
+    // Time the ray enters wall tile (x, y) grown by halfSize, if it does.
+    // Just touching a side is not a hit, so a box resting against a wall
+    // can slide along it. A box that rounding has left slightly inside a
+    // wall hits it straight away if moving further in.
+    auto hitTile = [&](int x, int y, float& entry, glm::vec2& n) {
+        float enter = -INFINITY, exit = INFINITY;
+        float depth = INFINITY;
+        glm::vec2 out;
+        for (int a = 0; a < 2; ++a) {
+            float lo = (a ? y : x) - halfSize[a];
+            float hi = (a ? y : x) + 1.0f + halfSize[a];
+            if (center[a] - lo < depth || hi - center[a] < depth) {
+                bool low = center[a] - lo < hi - center[a];
+                depth = low ? center[a] - lo : hi - center[a];
+                out = glm::vec2(0.0f);
+                out[a] = low ? -1.0f : 1.0f;
             }
+            if (motion[a] == 0.0f) {
+                if (center[a] <= lo || center[a] >= hi)
+                    return false;
+                continue;
+            }
+            float t0 = (lo - center[a]) / motion[a];
+            float t1 = (hi - center[a]) / motion[a];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            if (t0 > enter) {
+                enter = t0;
+                n = glm::vec2(0.0f);
+                n[a] = motion[a] > 0 ? -1.0f : 1.0f;
+            }
+            exit = std::min(exit, t1);
+        }
+        if (enter >= exit || enter > 1.0f || exit <= 0.0f)
+            return false;
+        if (enter < 0.0f) {
+            if (glm::dot(motion, out) >= 0.0f)
+                return false;
+            enter = 0.0f;
+            n = out;
+        }
+        entry = enter;
+        return true;
+    };
 
-            auto adjacents = getAdjacents(top);
-            for (auto& a : adjacents) {
-                auto& aTile = tiles[a.x][a.y].type;
-                if (aTile == Type::Wall || aTile == Type::Exit) {
-                    path[a] = glm::ivec2(top);
-                    consider.push(a);
+    int x = (int) floorf(center.x), y = (int) floorf(center.y);
+    const int stepX = motion.x > 0 ? 1 : -1;
+    const int stepY = motion.y > 0 ? 1 : -1;
+    // Time to cross one tile, and until the next tile edge, on each axis
+    const float deltaX = motion.x != 0 ? fabsf(1.0f / motion.x) : INFINITY;
+    const float deltaY = motion.y != 0 ? fabsf(1.0f / motion.y) : INFINITY;
+    float nextX = motion.x != 0 ?
+        ((motion.x > 0 ? x + 1 - center.x : center.x - x) * deltaX) : INFINITY;
+    float nextY = motion.y != 0 ?
+        ((motion.y > 0 ? y + 1 - center.y : center.y - y) * deltaY) : INFINITY;
+
+    bool hit = false;
+    t = 1.0f;
+    float entered = 0.0f;
+    while (entered <= t) {
+        for (int j = y - 1; j <= y + 1; ++j) {
+            for (int i = x - 1; i <= x + 1; ++i) {
+                float entry;
+                glm::vec2 n;
+                if (solid(i, j) && hitTile(i, j, entry, n) &&
+                        (!hit || entry < t)) {
+                    hit = true;
+                    t = entry;
+                    normal = n;
                 }
             }
-        } 
+        }
+        if (nextX < nextY) {
+            entered = nextX;
+            nextX += deltaX;
+            x += stepX;
+        } else {
+            entered = nextY;
+            nextY += deltaY;
+            y += stepY;
+        }
+    }
+    return hit;
+}
+
+glm::vec2 Maze::sweep(glm::vec2 center, glm::vec2 halfSize,
+                      glm::vec2 motion) const {
+    // Gap left between box and wall, so rounding never puts it inside
+    static const float SKIN = 1e-4f;
+    // Each pass slides along one more face, after two the box is in a
+    // corner and cannot move any further
+    for (int pass = 0; pass < 3; ++pass) {
+        if (motion.x == 0.0f && motion.y == 0.0f)
+            break;
+        float t;
+        glm::vec2 normal;
+        if (!castBox(center, halfSize, motion, t, normal)) {
+            center += motion;
+            break;
+        }
+        // Move up to the wall, back off along its normal by SKIN, and
+        // keep only the part of what is left that runs along it
+        center += motion * t;
+        int a = normal.x != 0 ? 0 : 1;
+        center[a] += normal[a] * SKIN;
+        motion *= 1.0f - t;
+        motion[a] = 0.0f;
+    }
+    return center;
+}
+
+// Mark optimal path as found by DFS, walking back from exit cell
+void Maze::markPath(int exitX, int exitY) {
+    const int w = grid.getCellsW();
+    int x = exitX, y = exitY;
+    for (;;) {
+        grid.setPath(x, y);
+        uint8_t p = parents[(size_t) y * w + x];
+        if (p == PARENT_ROOT)
+            break;
+        switch ((Dir) (p - 1)) {
+            case Dir::East:  ++x; break;
+            case Dir::North: ++y; break;
+            case Dir::West:  --x; break;
+            case Dir::South: --y; break;
+        }
     }
 }
 
 void Maze::reset() {
-    build();
+    if (!chunks)
+        build();
+}
+
+uint64_t Maze::getVersion() const {
+    return builds + (chunks ? chunks->getGenerated() : 0);
+}
+
+bool Maze::isEndless() const {
+    return chunks != nullptr;
+}
+
+void Maze::stream(glm::vec2 pos) {
+    if (chunks)
+        chunks->stream(pos);
+}
+
+bool Maze::isVisited(int x, int y) const {
+    return chunks && chunks->isVisited(x, y);
+}
+
+void Maze::setVisited(int x, int y) {
+    if (chunks)
+        chunks->setVisited(x, y);
 }
 
 bool Maze::isEnd(glm::ivec2 point) {
@@ -2,81 +2,101 @@
 #define MAZE_H
 
 /*
- * Maze - generates maze using a DFS, constructs collision mesh.
- * Keeps track of player win state.
+ * Maze - generates maze with one of the algorithms in generator.h,
+ * answers collision queries against its walls.
+ * Keeps track of player win state. Walls are held in a compact WallGrid
+ * and handed out as tiles of the expanded grid. Faces are worked out from
+ * the tiles when asked for rather than kept, so a maze costs little more
+ * than its WallGrid.
+ *
+ * In endless mode there is no exit and the maze is instead streamed in
+ * chunks around the player by a ChunkCache.
  */
 
 #include <glm/glm.hpp>
 #include <vector>
-#include <unordered_map>
 #include <cstdint>
+#include <memory>
 
-// Direction a wall in maze is facing
-enum class Dir {
-    North,
-    East,
-    South,
-    West
-};
-
-struct Face {
-    glm::vec2 tilePos;
-    glm::vec3 points[2];
-    glm::vec3 normal;
-    Dir dir;
-};
+#include "wall_grid.h"
+#include "random.h"
+#include "generator.h"
+#include "face.h"
+#include "chunk_cache.h"
 
-enum class Type : uint8_t {
-    Wall = 0,
-    Floor,
-    Entrance,
-    Exit,
-    Path
-};
-
-struct Tile {
-    Type type;
-};
-
-// Need to hash glm::ivec2 for std::unordered_map
-struct hashivec2 {
-    std::size_t operator() (const glm::ivec2& a) const {
-        return std::hash<float>()(a.x) ^ std::hash<float>()(a.y);
-    }
-};
-
-typedef std::vector<Tile> TileRow;
-typedef std::vector<TileRow> TileGrid;
-typedef std::vector<Face> CollisionMesh;
+// Room for the most faces queryWalls() can return for one step of
+// movement
+static const int MAX_CONTACTS = 64;
 
 class Maze {
     public:
-        Maze(int width, int height);
+        // Same seed, algorithm and thread count gives the same sequence
+        // of mazes. threads > 1 carves the maze in that many regions in
+        // parallel.
+        Maze(int width, int height, Algorithm algorithm, uint64_t seed,
+             int threads = 1, bool endless = false);
         ~Maze() {}
 
-        TileGrid& getGrid();
-        Tile& getTile(int x, int y);
-        CollisionMesh mesh;
-        std::vector<int> facesAt(int x, int y);
+        WallGrid& getGrid();
+        // Tile in expanded coordinates - (1, 1) is the first cell
+        Tile getTile(int x, int y) const;
+        // Size of the expanded tile grid
+        int getWidth() const;
+        int getHeight() const;
+        // Faces of the walls around open tile (x, y). Writes at most 4
+        // to out and returns how many.
+        int facesAt(int x, int y, Face* out) const;
+        // Wall faces a box of half size halfSize at center could touch on
+        // its way along motion, read straight off the tiles. Writes at most
+        // capacity faces to out and returns how many.
+        int queryWalls(glm::vec2 center, glm::vec2 halfSize,
+                       glm::vec2 motion, WallContact* out,
+                       int capacity) const;
+        // Move a box of half size halfSize (under half a tile) at center
+        // along motion, stopping at the first wall it hits and sliding
+        // along it with what is left. Works for any length of motion.
+        // Returns the new center.
+        glm::vec2 sweep(glm::vec2 center, glm::vec2 halfSize,
+                        glm::vec2 motion) const;
         bool isEnd(glm::ivec2 point);
         glm::ivec2 getEnd();
         bool won();
         void reset();
 
+        // Changes whenever any tiles do, so anything built from them
+        // knows to rebuild
+        uint64_t getVersion() const;
+
+        bool isEndless() const;
+        // Load the chunks around the player in endless mode, call once per
+        // tick before anything else looks at the maze
+        void stream(glm::vec2 pos);
+        // Tiles visited by the player, only kept here in endless mode
+        bool isVisited(int x, int y) const;
+        void setVisited(int x, int y);
+
     private:
-        void blendAdjacent(glm::ivec2 a, glm::ivec2 b, Type t);
-        void DFS(int startX, int startY);
-        void addFace(int tX, int tY, int offX, int offY);
-        void lookupInsert(int x, int y, int i);
-        std::vector<glm::ivec2> getAdjacents(glm::ivec2 dbt);
+        void markPath(int exitX, int exitY);
+        // Is tile (x, y) a wall, anything off the grid is
+        bool solid(int x, int y) const;
+        // Time along motion (0-1) the box first touches a wall, and the
+        // normal of the face it touches. Returns false if it hits nothing.
+        bool castBox(glm::vec2 center, glm::vec2 halfSize, glm::vec2 motion,
+                     float& t, glm::vec2& normal) const;
         glm::ivec2 end;
         void build();
 
-        TileGrid tiles;
+        WallGrid grid;
+        std::unique_ptr<ChunkCache> chunks; // Only set in endless mode
+        uint64_t builds;
         bool exitFound;
         bool winState;
-        std::unordered_map<glm::ivec2, glm::ivec2, hashivec2> path;
-        std::unordered_map<int, std::vector<int>> faceLookup;
+        Algorithm algorithm;
+        int threads;
+        Random rng;
+        /* Per cell direction back towards the entrance, reused *
+         * between builds so generation does not allocate      */
+        std::vector<uint8_t> parents;
 };
 
 #endif
@@ -0,0 +1,57 @@
+#ifndef MESHER_H
+#define MESHER_H
+
+/*
+ * Mesher - merges the exposed faces of walls that lie along the same line
+ * and face the same way into runs, so a straight stretch of wall becomes
+ * one long quad rather than one per tile.
+ *
+ * Faces facing north/south run along rows, east/west along columns. Runs
+ * never leave the rectangle given, so anything baked per chunk can mesh
+ * each chunk on its own. Purely header since it is templated on how
+ * tiles are looked up.
+ */
+
+#include <vector>
+
+#include "wall_grid.h"
+
+struct FaceRun {
+    int x, y;   // Open tile the run starts at, the lowest x or y
+    Dir dir;    // Direction the faces face, into the open tiles
+    int length; // Tiles, along +x for north/south, +y for east/west
+};
+
+// open(x, y) says whether a tile is open. Only asked about tiles inside
+// [lo, hi) and the neighbours of open ones.
+template <typename Open>
+void meshFaces(Open open, int loX, int loY, int hiX, int hiY,
+               std::vector<FaceRun>& runs) {
+    // Wall behind a face facing each direction, relative to the open tile
+    static const struct { Dir dir; int offX, offY; } SIDES[] = {
+        {Dir::North, 0, -1}, {Dir::South, 0, 1},
+        {Dir::East, -1, 0}, {Dir::West, 1, 0}
+    };
+    for (const auto& side : SIDES) {
+        const bool alongX = side.offX == 0;
+        const int outerLo = alongX ? loY : loX, outerHi = alongX ? hiY : hiX;
+        const int innerLo = alongX ? loX : loY, innerHi = alongX ? hiX : hiY;
+        for (int o = outerLo; o < outerHi; ++o) {
+            int start = -1;
+            for (int i = innerLo; i <= innerHi; ++i) {
+                const int x = alongX ? i : o, y = alongX ? o : i;
+                const bool face = i < innerHi && open(x, y) &&
+                    !open(x + side.offX, y + side.offY);
+                if (face && start < 0) {
+                    start = i;
+                } else if (!face && start >= 0) {
+                    runs.push_back({alongX ? start : o, alongX ? o : start,
+                                    side.dir, i - start});
+                    start = -1;
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -1,26 +1,30 @@
 #include "minimap.h"
 
 #include <glm/gtc/matrix_transform.hpp>
-#include <cstring>
-#include <map>
+#include <cstdlib>
+#include <thread>
 
 #include "maze.h"
 
-static const Color PATH_COLOR(150, 150, 150, 255);
-static const Color WALL_COLOR(0, 0, 0, 0);
-static const Color FLOOR_COLOR(255, 255, 255, 255);
-static const Color ENTRANCE_COLOR(0, 200, 50, 255);
-static const Color EXIT_COLOR(0, 255, 255, 255);
-static const Color EXPLORED(110, 20, 20, 255);
-
-// Map tile types to colors
-static std::map<Type, Color> COLOR_MAP = {
-    {Type::Wall, WALL_COLOR},
-    {Type::Floor, FLOOR_COLOR},
-    {Type::Path, FLOOR_COLOR},
-    {Type::Entrance, ENTRANCE_COLOR},
-    {Type::Exit, EXIT_COLOR}
+// Changed rectangles kept before giving up and sending it all
+static const size_t MAX_DIRTY = 16;
+// Lowest level kept as summaries, below it texels are few enough tiles
+// to look at each
+static const int SUMMARY_LEVEL = 2;
+// Furthest out an endless maze zooms, staying within the loaded chunks
+static const int MAX_ENDLESS_LEVEL = 2;
+
+// Each texel's flags, as in minimap.frag. The top bits are how much of
+// it is open, 0-DENSITY_MAX.
+enum Flag : uint8_t {
+    OPEN = 1,
+    PATH = 2,
+    ENTRANCE = 4,
+    EXIT = 8,
+    VISITED = 16
 };
+static const int DENSITY_SHIFT = 5;
+static const int DENSITY_MAX = 7;
 
 static float BASE_VERTS[] = {
 /*  Color               TexCoords   */
@@ -32,76 +36,145 @@ static float BASE_VERTS[] = {
     0.0f, 0.0f, 1.0f,   0.0f, 0.0f
 };
 
+// Past a few rectangles, sending the whole texture is cheaper than
+// sending each
+static void markDirty(std::vector<glm::ivec4>& dirty, glm::ivec4 rect,
+                      int w, int h) {
+    glm::ivec4 all(0, 0, w, h);
+    if (!dirty.empty() && dirty[0] == all)
+        return;
+    if (dirty.size() >= MAX_DIRTY)
+        dirty.assign(1, all);
+    else
+        dirty.push_back(rect);
+}
+
+// Flags of a texel from the four below it - anything in any of them, and
+// how open they are on average
+static uint8_t combine(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    const int mask = (1 << DENSITY_SHIFT) - 1;
+    const int density = ((a >> DENSITY_SHIFT) + (b >> DENSITY_SHIFT) +
+        (c >> DENSITY_SHIFT) + (d >> DENSITY_SHIFT) + 2) / 4;
+    return ((a | b | c | d) & mask) | (density << DENSITY_SHIFT);
+}
+
+// Run work(first, step) on each thread, work covering rows first, first +
+// step and so on
+template <typename Work>
+static void parallelRows(Work work) {
+    const int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (int n = 1; n < threads; ++n)
+        workers.push_back(std::thread(work, n, threads));
+    work(0, threads);
+    for (std::thread& t : workers)
+        t.join();
+}
+
 Minimap::Minimap(Maze& m, int screenW, int screenH) {
     pathStatus = hidden = false;
+    level = 0;
     reset(m);
     reshape(screenW, screenH); 
 }
 
-// Must clear up memory allocated to textures
-Minimap::~Minimap() {
-    delete[] texture;
-    delete[] localTexture;
-}
-
 void Minimap::reset(Maze& m) {
     maze = &m;
-    TileGrid tiles = m.getGrid();
-    mazeW = tiles.size();
-    mazeH = tiles[0].size();
-    // Align texture size to nearest power of 2
-    texW = pow(2, ceil(log2(mazeW)));
-    texH = pow(2, ceil(log2(mazeH)));
+    mazeW = m.getWidth();
+    mazeH = m.getHeight();
     mapW = 32;
     mapH = 32;
     lastPos = {1, 1};
-    visited.clear();
-    floorPoints.clear();
-
-    texture = new unsigned char[texW*texH*4];
-    localTexture = new unsigned char[mapW*mapH*4];
-    Color color;
-
-    for (int i = texH - 1; i >= 0; --i) {
-        for (int j = 0; j < texW; ++j) {
-            if (j < mazeW && i < mazeH) {
-                color = COLOR_MAP[tiles[j][i].type];
-                if (tiles[j][i].type == Type::Floor)
-                    floorPoints.push_back({j, i});
+    window = glm::ivec2(0, 0);
+    windowFilled = false;
+    texels.assign(mapW*mapH, 0);
+    dirty.assign(1, {0, 0, mapW, mapH});
+    explored = openTiles = 0;
+    needUpdate = true;
+
+    topLevel = 0;
+    while (mazeW > (mapW << topLevel) || mazeH > (mapH << topLevel))
+        ++topLevel;
+    if (m.isEndless())
+        topLevel = std::min(topLevel, MAX_ENDLESS_LEVEL);
+    level = std::min(level, topLevel);
+
+    // Endless maze's visited tiles are kept with its chunks, and the
+    // window is drawn from them once the first update has them loaded
+    if (m.isEndless()) {
+        levels.clear();
+        visited.resize(0, 0);
+        path.resize(0, 0);
+        return;
+    }
+    visited.resize(mazeW, mazeH);
+    path.resize(mazeW, mazeH);
+    buildLevels();
+    moveWindow();
+}
+
+void Minimap::buildLevels() {
+    // Each thread counts its own open tiles. Rows of the bitplane are
+    // whole words, so threads never share one.
+    std::vector<size_t> open(std::max(1u,
+                                      std::thread::hardware_concurrency()));
+    parallelRows([this, &open](int first, int step) {
+        for (int y = first; y < mazeH; y += step) {
+            for (int x = 0; x < mazeW; ++x) {
+                const Type type = maze->getTile(x, y).type;
+                open[first] += type != Type::Wall;
+                if (type == Type::Path)
+                    path.set(x, y);
             }
-            texture[4*(i*texW + j)] = color.x;
-            texture[4*(i*texW + j)+1] = color.y;
-            texture[4*(i*texW + j)+2] = color.z;
-            texture[4*(i*texW + j)+3] = color.w;
         }
-    }
+    });
+    for (size_t n : open)
+        openTiles += n;
 
-    needUpdate = true;
+    // The first summary is worked out from the tiles, each after it from
+    // the one before
+    levels.clear();
+    for (int l = SUMMARY_LEVEL; l <= topLevel; ++l) {
+        const glm::ivec2 size = levelSize(l);
+        std::vector<uint8_t> summary(size.x * size.y);
+        parallelRows([this, l, size, &summary](int first, int step) {
+            for (int y = first; y < size.y; y += step)
+                for (int x = 0; x < size.x; ++x)
+                    summary[y*size.x + x] = texel(l, x, y);
+        });
+        levels.push_back(std::move(summary));
+    }
 }
 
 void Minimap::togglePath() {
-    // Toggle color in tile -> color map
-    Color color = pathStatus ? FLOOR_COLOR : PATH_COLOR;
-    COLOR_MAP[Type::Path] = color;
+    // No known path through an endless maze
+    if (maze->isEndless())
+        return;
     pathStatus = !pathStatus;
-    for (auto& v : floorPoints)
-        set(v.x, v.y, color.x, color.y, color.z);
+    needUpdate = true;
+}
 
-    color = EXPLORED;
-    for (auto& v : visited)
-        set(v.x, v.y, color.x, color.y, color.z);
+void Minimap::zoom(int steps) {
+    const int next = std::max(0, std::min(topLevel, level + steps));
+    if (next == level)
+        return;
+    level = next;
+    windowFilled = false;
+    moveWindow();
+    needUpdate = true;
 }
 
 void Minimap::update(glm::vec2 pos) {
+    if (!windowFilled) {
+        moveWindow();
+        needUpdate = true;
+    }
     if (glm::ivec2(pos.x, pos.y) == glm::ivec2(lastPos.x, lastPos.y))
         return;
-    visited.push_back({(int) pos.x, (int) pos.y});
-    auto& color = EXPLORED;
-
-    // Must update previous & current positions
-    set((int) lastPos.x, (int) lastPos.y, color.x, color.y, color.z);
-    set((int) pos.x, (int) pos.y, 255, 0, 0);
+    glm::ivec2 last(lastPos.x, lastPos.y);
     lastPos = pos;
+    setVisited(last.x, last.y);
+    moveWindow();
     needUpdate = true; // Make sure update is propagated to renderer
 }
 
@@ -114,30 +187,146 @@ float Minimap::getShadowSize() {
         ((1.0f / (float) mapW) / (float) pxPerTile);
 }
 
-// Update local minimap texture if necessary. 
-unsigned char* Minimap::getTexture() {
-    if (needUpdate) {
-        // Scrolling minimap - only shows 32x32 area around player
-        const int offX = (int) (std::max(0, mapW - mazeW) / 2);
-        const int offY = (int) (std::max(0, mapH - mazeH) / 2);
-        const int midPosX = std::max(1, std::min(mazeW - mapW + 1,
-                    (int) lastPos.x + 1 - mapW / 2));
-        const int midPosY = std::max(1, std::min(mazeH - mapH + 1,
-                    (int) lastPos.y + 1 - mapH / 2));
-        const int topLeft = 4*(((int)midPosY - 1)*texW + (int)midPosX - 1);
-
-        // Update row-by-row within square around player, but not past
-        // edges
-        for (int i = 0; i < mapH; ++i) {
-            memcpy(localTexture + 4*i*mapW,
-                    texture + topLeft + 4*i*texW,
-                    mapW * 4 * sizeof(unsigned char));
-        }
+const uint8_t* Minimap::getTexels() {
+    return texels.data();
+}
+
+const std::vector<glm::ivec4>& Minimap::getDirty() {
+    return dirty;
+}
+
+void Minimap::clearDirty() {
+    dirty.clear();
+    needUpdate = false;
+}
+
+glm::ivec2 Minimap::getOrigin() {
+    return window;
+}
+
+glm::ivec2 Minimap::getPlayer() {
+    return glm::ivec2((int) lastPos.x >> level, (int) lastPos.y >> level);
+}
+
+int Minimap::getLevel() {
+    return level;
+}
+
+bool Minimap::showsPath() {
+    return pathStatus;
+}
+
+size_t Minimap::getExplored() {
+    return explored;
+}
+
+size_t Minimap::getOpenTiles() {
+    return openTiles;
+}
+
+size_t Minimap::getPathExplored() {
+    return visited.countAnd(path);
+}
+
+size_t Minimap::getPathTiles() {
+    return path.count();
+}
+
+// Scrolling minimap - only shows 32x32 texels around player, but not past
+// the edges of a fixed maze
+void Minimap::moveWindow() {
+    const glm::ivec2 size = levelSize(level);
+    const glm::ivec2 player = getPlayer();
+    glm::ivec2 next(
+        std::max(0, std::min(size.x - mapW, player.x - mapW / 2)),
+        std::max(0, std::min(size.y - mapH, player.y - mapH / 2)));
+    if (windowFilled && next == window)
+        return;
 
-        needUpdate = false;
+    // Fill in the columns and rows of the ring the window has moved
+    // onto. Each covers the ring's whole height or width. Moving further
+    // than the ring is wide fills every column.
+    glm::ivec2 moved = next - window;
+    if (!windowFilled || std::abs(moved.x) >= mapW ||
+        std::abs(moved.y) >= mapH) {
+        moved = glm::ivec2(mapW, 0);
+        window = next - moved;
     }
+    const int firstX = moved.x > 0 ? window.x + mapW : next.x;
+    const int firstY = moved.y > 0 ? window.y + mapH : next.y;
+    for (int x = firstX; x < firstX + std::abs(moved.x); ++x) {
+        for (int y = next.y; y < next.y + mapH; ++y)
+            fillTexel(x, y);
+        markDirty(dirty, {x % mapW, 0, 1, mapH}, mapW, mapH);
+    }
+    for (int y = firstY; y < firstY + std::abs(moved.y); ++y) {
+        for (int x = next.x; x < next.x + mapW; ++x)
+            fillTexel(x, y);
+        markDirty(dirty, {0, y % mapH, mapW, 1}, mapW, mapH);
+    }
+    window = next;
+    windowFilled = true;
+}
+
+glm::ivec2 Minimap::levelSize(int l) {
+    return glm::ivec2((mazeW + (1 << l) - 1) >> l,
+                      (mazeH + (1 << l) - 1) >> l);
+}
+
+// Texels past the maze's edges are left empty, as walls are
+uint8_t Minimap::texel(int l, int x, int y) {
+    const glm::ivec2 size = levelSize(l);
+    if (x < 0 || y < 0 || x >= size.x || y >= size.y)
+        return 0;
+    if (l == 0)
+        return tileFlags(x, y);
+    if (l >= SUMMARY_LEVEL && l - SUMMARY_LEVEL < (int) levels.size())
+        return levels[l - SUMMARY_LEVEL][y*size.x + x];
+    return combine(texel(l - 1, 2*x, 2*y), texel(l - 1, 2*x + 1, 2*y),
+                   texel(l - 1, 2*x, 2*y + 1),
+                   texel(l - 1, 2*x + 1, 2*y + 1));
+}
+
+uint8_t Minimap::tileFlags(int x, int y) {
+    const Type type = maze->getTile(x, y).type;
+    if (type == Type::Wall)
+        return 0;
+    uint8_t flags = OPEN | (DENSITY_MAX << DENSITY_SHIFT);
+    if (type == Type::Path)
+        flags |= PATH;
+    else if (type == Type::Entrance)
+        flags |= ENTRANCE;
+    else if (type == Type::Exit)
+        flags |= EXIT;
+    if (maze->isEndless() ? maze->isVisited(x, y) : visited.get(x, y))
+        flags |= VISITED;
+    return flags;
+}
 
-    return localTexture;
+void Minimap::fillTexel(int x, int y) {
+    texels[(y % mapH)*mapW + x % mapW] = texel(level, x, y);
+}
+
+// Summaries only ever gain visited tiles, so each just has the bit set,
+// and the window's texel is filled in again if it is in view
+void Minimap::setVisited(int x, int y) {
+    if (maze->isEndless()) {
+        explored += !maze->isVisited(x, y);
+        maze->setVisited(x, y);
+    } else {
+        explored += !visited.get(x, y);
+        visited.set(x, y);
+        for (int l = SUMMARY_LEVEL; l <= topLevel; ++l)
+            levels[l - SUMMARY_LEVEL][(y >> l)*levelSize(l).x + (x >> l)] |=
+                VISITED;
+    }
+
+    const int tx = x >> level, ty = y >> level;
+    if (tx >= window.x && tx < window.x + mapW &&
+        ty >= window.y && ty < window.y + mapH) {
+        fillTexel(tx, ty);
+        markDirty(dirty, {tx % mapW, ty % mapH, 1, 1}, mapW, mapH);
+    }
 }
 
 void Minimap::reshape(int w, int h) {
@@ -168,18 +357,6 @@ void Minimap::reshape(int w, int h) {
     }
 }
 
-Color Minimap::set(int x, int y, int r, int g, int b) {
-    int loc = 4*(y*texW + x);
-    // don't change transparent tiles (walls)
-    if (texture[loc+3] != 0) {
-        texture[loc+0] = r;
-        texture[loc+1] = g;
-        texture[loc+2] = b;
-    }
-    return {texture[loc+0], texture[loc+1],
-            texture[loc+2], texture[loc+3]};
-}
-
 void Minimap::loadBaseVerts() {
     vertices.resize(sizeof(BASE_VERTS)/sizeof(float));
     for (int i = 0; i < vertices.size(); ++i) {
@@ -8,21 +8,32 @@
  * showing optimal path to maze exit. Tiles player has visited
  * are marked red.
  *
- * Minimap is held as a texture drawn onto a 2D quad. Drop shadow
- * is applied via shader.
+ * Minimap is drawn onto a 2D quad by its shader, from one 32x32 texture
+ * of the window around the player - texel (x, y) always at (x mod 32,
+ * y mod 32), so scrolling only fills in the new rows and columns. Each
+ * texel is a byte of flags (see Flag in minimap.cpp) saying what is in
+ * it. The player marker, path toggle and drop shadow are uniforms or done
+ * in the shader.
+ *
+ * '-' and '=' (or the mouse wheel) zoom out and in a level at a time,
+ * each level's texels covering twice as many tiles across as the one
+ * below, up to the level the whole maze fits in the window. Levels from
+ * SUMMARY_LEVEL up are kept as summaries of every texel, built in
+ * parallel with the maze and updated as tiles are visited; those below
+ * are cheap enough to work out from the tiles as the window moves. An
+ * endless maze has no summaries, so only zooms out a little way.
  */
 
 #include <glm/glm.hpp>
 #include <vector>
+#include <cstdint>
 
 #include "maze.h"
-
-typedef glm::ivec4 Color;
+#include "bitplane.h"
 
 class Minimap {
     public:
         Minimap(Maze& m, int screenW, int screenH);
-        ~Minimap();
 
         void togglePath();
         void update(glm::vec2 pos);
@@ -30,9 +41,29 @@ class Minimap {
         void reset(Maze& m);
         void toggle();
         bool enabled();
+        /* Zoom out (positive) or in by steps levels */
+        void zoom(int steps);
 
         std::vector<float> getVertices();
-        unsigned char* getTexture();
+        /* Flags of the texels in the window, getWidth() to a row */
+        const uint8_t* getTexels();
+        /* Rectangles (x, y, w, h) of texels changed since the last *
+         * clearDirty()                                              */
+        const std::vector<glm::ivec4>& getDirty();
+        void clearDirty();
+        /* First texel in the window shown, and the player's texel, *
+         * at the level shown                                        */
+        glm::ivec2 getOrigin();
+        glm::ivec2 getPlayer();
+        int getLevel();
+        bool showsPath();
+        /* Open tiles the player has been on, of how many there are, *
+         * and the same for the tiles on the path to the exit. Only   *
+         * the first for endless mazes, counting from the start.      */
+        size_t getExplored();
+        size_t getOpenTiles();
+        size_t getPathExplored();
+        size_t getPathTiles();
         float getShadowSize();
         bool needsUpdate();
         int getWidth();
@@ -42,26 +73,29 @@ class Minimap {
         /* Width/height of minimap squares when drawn to screen */
         int pxPerTile;
 
-        /* Width and height of minimap texture - set to 32 */
+        /* Width and height of minimap window - set to 32 */
         int mapW;
         int mapH;
         /* Width and height of backing maze, for convenience */
         int mazeW;
         int mazeH;
 
-        /* Width and height of entire map texture, scaled to nearest *
-         * power of two to play friendly with OpenGL texture loading */
-        int texW;
-        int texH;
-
         Maze* maze;             // Backing maze
         glm::vec2 lastPos;      // Last position player was at
-        unsigned char* texture; // Texture of maze
-        /* Minimap texture (tiles within range only) */
-        unsigned char* localTexture; 
+        glm::ivec2 window;      // First texel in the window
+        bool windowFilled;      // Does the ring hold window?
+        int level;              // Level shown, 2^level tiles a texel across
+        int topLevel;           // Level the whole maze fits the window at
+        std::vector<uint8_t> texels;
+        /* Summaries of each level from SUMMARY_LEVEL up to topLevel, *
+         * for fixed mazes                                             */
+        std::vector<std::vector<uint8_t>> levels;
+        Bitplane visited;       // Tiles visited, for fixed mazes
+        Bitplane path;          // Tiles on the path, for fixed mazes
+        size_t explored;
+        size_t openTiles;
+        std::vector<glm::ivec4> dirty;
         std::vector<float> vertices;
-        std::vector<glm::ivec2> floorPoints; // For toggling optimal path
-        std::vector<glm::ivec2> visited;     // Tiles visited by player
 
         /* Is minimap hidden? - toggled with 'm' */
         bool hidden;
@@ -71,8 +105,20 @@ class Minimap {
         bool needUpdate;
 
         void loadBaseVerts();   // Load base minimap quad
-        /* Set pixel (x, y) on minimap texture to color (r, g, b) */
-        Color set(int x, int y, int r, int g, int b);
+        /* Move window to keep the player in the middle of it */
+        void moveWindow();
+        /* Texels across and up level l */
+        glm::ivec2 levelSize(int l);
+        /* Flags of texel (x, y) of level l, summarised or worked out */
+        uint8_t texel(int l, int x, int y);
+        /* Flags of tile (x, y) */
+        uint8_t tileFlags(int x, int y);
+        /* Build the summaries, and count open and path tiles */
+        void buildLevels();
+        /* Fill texel (x, y) of the level shown into its place in the ring */
+        void fillTexel(int x, int y);
+        /* Mark tile (x, y) visited, everywhere it shows */
+        void setVisited(int x, int y);
 };
 
 #endif
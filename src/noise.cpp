@@ -0,0 +1,91 @@
+#include "noise.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#include "random.h"
+
+static float fade(float t) {
+    return t*t*t*(t*(t*6.0f - 15.0f) + 10.0f);
+}
+
+static float lerp(float t, float a, float b) {
+    return a + t*(b - a);
+}
+
+// Dot of (x, y, z) with one of 12 edge directions of a cube, picked by
+// the hash
+static float grad(int hash, float x, float y, float z) {
+    const int h = hash & 15;
+    const float u = h < 8 ? x : y;
+    const float v = h < 4 ? y : h == 12 || h == 14 ? x : z;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+float periodicNoise(const uint8_t perm[512], float x, float y, float z,
+                    int periodX, int periodY, int periodZ) {
+    const float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    x -= fx;
+    y -= fy;
+    z -= fz;
+    // Lattice corners wrap at the period, which must be at most 256
+    auto wrap = [](float f, int period) {
+        int i = (int) f % period;
+        return i < 0 ? i + period : i;
+    };
+    const int x0 = wrap(fx, periodX), x1 = (x0 + 1) % periodX;
+    const int y0 = wrap(fy, periodY), y1 = (y0 + 1) % periodY;
+    const int z0 = wrap(fz, periodZ), z1 = (z0 + 1) % periodZ;
+    auto hash = [perm](int i, int j, int k) {
+        return perm[perm[perm[i] + j] + k];
+    };
+
+    const float u = fade(x), v = fade(y), w = fade(z);
+    return lerp(w,
+        lerp(v, lerp(u, grad(hash(x0, y0, z0), x, y, z),
+                        grad(hash(x1, y0, z0), x - 1, y, z)),
+                lerp(u, grad(hash(x0, y1, z0), x, y - 1, z),
+                        grad(hash(x1, y1, z0), x - 1, y - 1, z))),
+        lerp(v, lerp(u, grad(hash(x0, y0, z1), x, y, z - 1),
+                        grad(hash(x1, y0, z1), x - 1, y, z - 1)),
+                lerp(u, grad(hash(x0, y1, z1), x, y - 1, z - 1),
+                        grad(hash(x1, y1, z1), x - 1, y - 1, z - 1))));
+}
+
+void bakeNoise(std::vector<float>& out, int w, int h, int d, int perCell,
+               uint64_t seed, int threads) {
+    // Shuffled lattice hash, the same for the same seed
+    uint8_t perm[512];
+    for (int i = 0; i < 256; ++i)
+        perm[i] = i;
+    Random rng(seed);
+    for (int i = 255; i > 0; --i)
+        std::swap(perm[i], perm[rng.below(i + 1)]);
+    for (int i = 0; i < 256; ++i)
+        perm[256 + i] = perm[i];
+
+    out.resize((size_t) w * h * d);
+    const int periodX = w / perCell, periodY = h / perCell;
+    const int periodZ = d / perCell;
+    threads = std::max(1, std::min(threads, d));
+    auto work = [&](int n) {
+        for (int z = n; z < d; z += threads) {
+            float* slice = &out[(size_t) z * w * h];
+            const float nz = (z + 0.5f) / perCell;
+            for (int y = 0; y < h; ++y) {
+                const float ny = (y + 0.5f) / perCell;
+                for (int x = 0; x < w; ++x)
+                    slice[y * w + x] = periodicNoise(perm,
+                        (x + 0.5f) / perCell, ny, nz,
+                        periodX, periodY, periodZ);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int n = 1; n < threads; ++n)
+        workers.push_back(std::thread(work, n));
+    work(0);
+    for (auto& t : workers)
+        t.join();
+}
@@ -0,0 +1,26 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+/*
+ * Noise - 3D gradient noise (Perlin's improved noise) that repeats, baked
+ * into a volume once at startup so the maze shader can look it up rather
+ * than work it out for every fragment.
+ *
+ * The lattice wraps every period cells on each axis, so the volume tiles
+ * seamlessly with GL_REPEAT. Slices along z are split between threads.
+ */
+
+#include <vector>
+#include <cstdint>
+
+// Noise at (x, y, z) in lattice cells, roughly -1 to 1, repeating every
+// periodX/Y/Z cells. perm is a shuffle of 0-255 repeated twice.
+float periodicNoise(const uint8_t perm[512], float x, float y, float z,
+                    int periodX, int periodY, int periodZ);
+
+// Fill out with w x h x d samples (x fastest) of noise from seed, at
+// perCell samples per lattice cell, taken at the centres of the samples
+void bakeNoise(std::vector<float>& out, int w, int h, int d, int perCell,
+               uint64_t seed, int threads);
+
+#endif
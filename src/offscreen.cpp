@@ -0,0 +1,62 @@
+#include "offscreen.h"
+
+#include <EGL/eglext.h>
+#include <iostream>
+
+// Only GLEW 2.1 on reports this, older ones don't fail without X
+#ifndef GLEW_ERROR_NO_GLX_DISPLAY
+#define GLEW_ERROR_NO_GLX_DISPLAY GLEW_OK
+#endif
+
+bool Offscreen::init() {
+    // Surfaceless needs no X or Wayland display, fall back on the
+    // default one where the extension is missing
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Offscreen: no EGL display\n";
+        return false;
+    }
+
+    // Same version and profile as the window's, with no config or
+    // surface since it only draws into FBOs
+    const EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+                               attribs);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "Offscreen: couldn't make a 4.5 core context, error "
+            << std::hex << eglGetError() << std::dec << '\n';
+        return false;
+    }
+
+    // GLEW built for GLX loads GL's functions, then complains there is
+    // no X display to load GLX's from. Those aren't needed here.
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "Offscreen: " << glewGetErrorString(err) << '\n';
+        return false;
+    }
+    return true;
+}
+
+Offscreen::~Offscreen() {
+    if (display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    eglTerminate(display);
+}
@@ -0,0 +1,27 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+/*
+ * Offscreen - an OpenGL 4.5 context with no window, for machines with no
+ * display. Made through EGL's surfaceless platform, which Mesa has even
+ * with no GPU (llvmpipe). There is no default framebuffer, everything is
+ * drawn into FBOs.
+ */
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+class Offscreen {
+public:
+    Offscreen() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+    ~Offscreen();
+
+    // Make the context current, false if there is no way to
+    bool init();
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+};
+
+#endif
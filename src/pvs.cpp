@@ -0,0 +1,255 @@
+#include "pvs.h"
+
+#include <cmath>
+#include <map>
+#include <thread>
+#include <algorithm>
+
+static const uint32_t NO_SET = ~(uint32_t) 0;
+// Sight lines are kept as u = m*v + c in a frame where they head along
+// +v (see Portals). Slopes are bounded by SLOPE, so lines within about
+// range / SLOPE tiles of running sideways are left out, far below a
+// pixel. Constraints are loosened by SLACK so rounding never drops a
+// line that just grazes a corner.
+static const double SLOPE = 1.0e6;
+static const double SLACK = 1.0e-7;
+
+// Sets found by one thread, numbered in the order found
+struct LocalSets {
+    std::vector<std::vector<int>> sets;
+    std::map<std::vector<int>, uint32_t> ids;
+
+    uint32_t add(const std::vector<int>& set) {
+        auto it = ids.find(set);
+        if (it != ids.end())
+            return it->second;
+        ids[set] = sets.size();
+        sets.push_back(set);
+        return sets.size() - 1;
+    }
+};
+
+// Walks out from one tile through the edges between open tiles
+// (portals) for one thread, gathering the chunks of every tile a sight
+// line could reach.
+//
+// A line leaving the source tile heads one way along its first portal's
+// normal, so in a frame where that is +v and u is across it, the line is
+// u = m*v + c. Passing a portal is two linear constraints on (m, c), so
+// the lines that get through every portal on a path form a convex
+// polygon in (m, c), clipped a portal at a time. Once it is empty no line
+// from the source tile goes that way. Every line that gets through is
+// counted, grazing corners included, so nothing that can be seen is left
+// out.
+struct Portals {
+    struct Line { double m, c; };
+
+    const std::vector<uint8_t>& open; // Per tile
+    int width;
+    int chunkTiles;
+    int chunksW;
+    float range;
+    int maxDepth; // Most tiles a line within range passes through
+    int sX, sY;   // Source tile
+    glm::ivec2 d, e; // Directions of +v and +u
+    std::vector<uint8_t> seen; // Per chunk, whether it is in set
+    std::vector<int> set;
+    std::vector<std::vector<Line>> polys; // Lines left at each depth
+    std::vector<Line> scratch;
+
+    void mark(int x, int y) {
+        const int c = (y / chunkTiles) * chunksW + x / chunkTiles;
+        if (!seen[c]) {
+            seen[c] = 1;
+            set.push_back(c);
+        }
+    }
+    bool isOpen(int x, int y) const {
+        return open[(size_t) y * width + x];
+    }
+
+    // Keep the lines with a*m + b*c <= k
+    static void clip(std::vector<Line>& poly, double a, double b,
+                     double k, std::vector<Line>& out) {
+        out.clear();
+        for (size_t i = 0; i < poly.size(); ++i) {
+            const Line& p = poly[i];
+            const Line& q = poly[(i + 1) % poly.size()];
+            const double fp = a * p.m + b * p.c - k;
+            const double fq = a * q.m + b * q.c - k;
+            if (fp <= 0)
+                out.push_back(p);
+            if ((fp < 0 && fq > 0) || (fp > 0 && fq < 0)) {
+                const double t = fp / (fp - fq);
+                out.push_back({p.m + t * (q.m - p.m), p.c + t * (q.c - p.c)});
+            }
+        }
+    }
+
+    // Lines in from, clipped to those passing the edge of tile (x, y)
+    // towards step, into to. False if none do.
+    bool pass(int x, int y, glm::ivec2 step, std::vector<Line>& from,
+              std::vector<Line>& to) {
+        const int along = step.x * d.x + step.y * d.y;
+        if (along < 0)
+            return false;
+        // Ends of the edge, relative to the source tile's center
+        const double midX = x - sX + 0.5 * step.x;
+        const double midY = y - sY + 0.5 * step.y;
+        double u[2], v[2];
+        for (int i = 0; i < 2; ++i) {
+            const double endX = midX + (i ? 0.5 : -0.5) * step.y;
+            const double endY = midY - (i ? 0.5 : -0.5) * step.x;
+            u[i] = endX * e.x + endY * e.y;
+            v[i] = endX * d.x + endY * d.y;
+        }
+        std::vector<Line>& tmp = scratch;
+        if (along > 0) {
+            // Across the way the line goes, it crosses v = v[0] between
+            // the ends' u
+            clip(from, -v[0], -1, SLACK - std::min(u[0], u[1]), tmp);
+            clip(tmp, v[0], 1, std::max(u[0], u[1]) + SLACK, to);
+        } else {
+            // Along it, the line is either side of u = u[0] at the ends'
+            // v, whichever way step goes across
+            const double v0 = std::min(v[0], v[1]), v1 = std::max(v[0], v[1]);
+            const double s = step.x * e.x + step.y * e.y;
+            clip(from, s * v0, s, s * u[0] + SLACK, tmp);
+            clip(tmp, -s * v1, -s, SLACK - s * u[0], to);
+        }
+        return to.size() >= 3;
+    }
+
+    // Carry on from tile (x, y), reached by the lines in polys[depth].
+    // A straight line only ever goes one way across, so once a path has
+    // stepped across it keeps going that way (side, 0 until then).
+    void walk(int x, int y, int depth, int side) {
+        mark(x, y);
+        if (depth + 1 >= maxDepth)
+            return;
+        static const glm::ivec2 STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (const glm::ivec2& step : STEPS) {
+            const int nX = x + step.x, nY = y + step.y;
+            const float gapX = std::max(0, std::abs(nX - sX) - 1);
+            const float gapY = std::max(0, std::abs(nY - sY) - 1);
+            const int across = step.x * e.x + step.y * e.y;
+            if (!isOpen(nX, nY) || gapX*gapX + gapY*gapY > range*range ||
+                across * side < 0)
+                continue;
+            if (pass(x, y, step, polys[depth], polys[depth + 1]))
+                walk(nX, nY, depth + 1, across ? across : side);
+        }
+    }
+
+    // Every chunk seen from anywhere in tile (x, y), into set
+    void from(int x, int y) {
+        sX = x;
+        sY = y;
+        mark(x, y);
+        static const glm::ivec2 DIRS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (const glm::ivec2& dir : DIRS) {
+            if (!isOpen(x + dir.x, y + dir.y))
+                continue;
+            d = dir;
+            e = glm::ivec2(dir.y, -dir.x);
+            polys[0] = {{-SLOPE, -SLOPE}, {SLOPE, -SLOPE},
+                        {SLOPE, SLOPE}, {-SLOPE, SLOPE}};
+            if (pass(x, y, dir, polys[0], polys[1]))
+                walk(x + dir.x, y + dir.y, 1, 0);
+        }
+    }
+};
+
+void Pvs::build(const Maze& m, int chunkTiles, float range, int threads) {
+    width = m.getWidth();
+    height = m.getHeight();
+    this->chunkTiles = chunkTiles;
+    chunksW = (width + chunkTiles - 1) / chunkTiles;
+    const int chunksH = (height + chunkTiles - 1) / chunkTiles;
+    tileSet.assign((size_t) width * height, NO_SET);
+    std::vector<uint8_t> open((size_t) width * height);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            open[(size_t) y * width + x] = m.getTile(x, y).type != Type::Wall;
+
+    // A line range long crosses at most this many tile edges
+    const int maxDepth = (int) std::ceil(range * std::sqrt(2.0f)) + 4;
+
+    // Each thread takes a band of rows. Its sets are merged into the
+    // shared ones afterwards, so threads never write to the same place.
+    threads = std::max(1, std::min(threads, height));
+    std::vector<LocalSets> local(threads);
+    auto work = [&](int n) {
+        const int y0 = (int) ((long long) height * n / threads);
+        const int y1 = (int) ((long long) height * (n + 1) / threads);
+        Portals c{open, width, chunkTiles, chunksW, range, maxDepth, 0, 0,
+                  {}, {}, std::vector<uint8_t>((size_t) chunksW * chunksH, 0),
+                  {}, std::vector<std::vector<Portals::Line>>(maxDepth + 1),
+                  {}};
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (!c.isOpen(x, y))
+                    continue;
+                c.set.clear();
+                c.from(x, y);
+                for (int k : c.set)
+                    c.seen[k] = 0;
+                std::sort(c.set.begin(), c.set.end());
+                tileSet[(size_t) y * width + x] = local[n].add(c.set);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int n = 1; n < threads; ++n)
+        workers.push_back(std::thread(work, n));
+    work(0);
+    for (auto& t : workers)
+        t.join();
+
+    // Merge every thread's sets, then point tiles at the merged ones
+    LocalSets merged;
+    std::vector<std::vector<uint32_t>> remap(threads);
+    for (int n = 0; n < threads; ++n)
+        for (const auto& set : local[n].sets)
+            remap[n].push_back(merged.add(set));
+    for (int n = 0; n < threads; ++n) {
+        const int y0 = (int) ((long long) height * n / threads);
+        const int y1 = (int) ((long long) height * (n + 1) / threads);
+        for (size_t t = (size_t) y0 * width; t < (size_t) y1 * width; ++t)
+            if (tileSet[t] != NO_SET)
+                tileSet[t] = remap[n][tileSet[t]];
+    }
+    setStart.assign(1, 0);
+    setChunks.clear();
+    for (const auto& set : merged.sets) {
+        setChunks.insert(setChunks.end(), set.begin(), set.end());
+        setStart.push_back(setChunks.size());
+    }
+}
+
+void Pvs::clear() {
+    tileSet.clear();
+    setStart.clear();
+    setChunks.clear();
+}
+
+ChunkRange Pvs::visible(int x, int y) const {
+    if (tileSet.empty() || x < 0 || y < 0 || x >= width || y >= height)
+        return {NULL, NULL};
+    const uint32_t s = tileSet[(size_t) y * width + x];
+    if (s == NO_SET)
+        return {NULL, NULL};
+    const int* chunks = setChunks.data();
+    return {chunks + setStart[s], chunks + setStart[s + 1]};
+}
+
+float Pvs::getAverage() const {
+    size_t tiles = 0, total = 0;
+    for (uint32_t s : tileSet) {
+        if (s == NO_SET)
+            continue;
+        ++tiles;
+        total += setStart[s + 1] - setStart[s];
+    }
+    return tiles ? (float) total / tiles : 0.0f;
+}
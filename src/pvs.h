@@ -0,0 +1,70 @@
+#ifndef PVS_H
+#define PVS_H
+
+/*
+ * Pvs - potentially visible set of every open tile of a fixed maze: the
+ * square chunks of tiles that can be seen from anywhere in it.
+ *
+ * Found by walking out from each tile through the edges between open
+ * tiles, keeping track of the straight lines from the tile that could
+ * still get through, and taking the chunk of every tile one reaches.
+ * Any line that gets through counts, so the set is conservative: a chunk
+ * that can be seen from anywhere in the tile is never left out (short of
+ * lines so close to sideways they rise a ten-thousandth of a tile over
+ * their whole length). Walls are taller than the camera, so nothing is
+ * seen over them. Neighbouring tiles mostly see the same chunks, so each
+ * distinct set is stored once and tiles just point at theirs. Rows of
+ * tiles are split between threads.
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "maze.h"
+
+// Non-owning view of a tile's visible chunk ids, valid until the next
+// build()
+struct ChunkRange {
+    const int* first;
+    const int* last;
+
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+class Pvs {
+public:
+    Pvs() : width(0), height(0), chunkTiles(1), chunksW(0) {}
+
+    // Sets for every open tile of m, with chunks chunkTiles tiles to a
+    // side from (0, 0) and sight lines at most range tiles long. Uses
+    // threads threads.
+    void build(const Maze& m, int chunkTiles, float range, int threads);
+    void clear();
+    bool empty() const { return tileSet.empty(); }
+
+    // Ids (y * getChunksW() + x, in chunks) of the chunks visible from
+    // tile (x, y), ascending. Empty if it isn't an open tile.
+    ChunkRange visible(int x, int y) const;
+    int getChunksW() const { return chunksW; }
+    // Distinct sets, and the average number of chunks in a tile's
+    size_t getSets() const {
+        return setStart.empty() ? 0 : setStart.size() - 1;
+    }
+    float getAverage() const;
+
+private:
+    int width;
+    int height;
+    int chunkTiles;
+    int chunksW;
+    /* Set s is setChunks[setStart[s]] up to setChunks[setStart[s + 1]], *
+     * tileSet holds each tile's set or NO_SET                           */
+    std::vector<uint32_t> tileSet;
+    std::vector<uint32_t> setStart;
+    std::vector<int> setChunks;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/*
+ * Random - small, fast PRNG (xoroshiro128+, seeded through splitmix64).
+ * Cheap enough to call once per carved cell, and each maze owns its own
+ * so generation never touches the global rand() state.
+ */
+
+#include <cstdint>
+
+class Random {
+public:
+    explicit Random(uint64_t s = 0) { seed(s); }
+
+    void seed(uint64_t s) {
+        state[0] = splitmix(s);
+        state[1] = splitmix(s);
+    }
+
+    uint64_t next() {
+        const uint64_t s0 = state[0];
+        uint64_t s1 = state[1];
+        const uint64_t result = s0 + s1;
+        s1 ^= s0;
+        state[0] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
+        state[1] = rotl(s1, 37);
+        return result;
+    }
+
+    // Uniform integer in [0, n), n must be > 0
+    uint32_t below(uint32_t n) {
+        return (uint32_t) (((next() >> 32) * (uint64_t) n) >> 32);
+    }
+
+private:
+    uint64_t state[2];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t splitmix(uint64_t& s) {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif
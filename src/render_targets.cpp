@@ -0,0 +1,94 @@
+#include "render_targets.h"
+
+#include <cassert>
+#include <cstddef>
+
+// Unused attachments kept around for a target to go back to
+static const size_t POOL_SIZE = 4;
+
+int RenderTargets::create(int w, int h, GLenum colorFormat,
+                          GLenum depthFormat) {
+    RenderTarget t;
+    glGenFramebuffers(1, &t.fbo);
+    t.color = t.depth = 0;
+    t.width = t.height = 0;
+    t.colorFormat = colorFormat;
+    t.depthFormat = depthFormat;
+    targets.push_back(t);
+    resize(targets.size() - 1, w, h);
+    return targets.size() - 1;
+}
+
+void RenderTargets::resize(int target, int w, int h) {
+    RenderTarget& t = targets[target];
+    if (t.color && t.width == w && t.height == h)
+        return;
+    // Old attachments go back to the pool first, so a target shrinking
+    // and growing again gets its own back
+    if (t.color) {
+        release(t.color, true, t.width, t.height, t.colorFormat);
+        if (t.depthFormat)
+            release(t.depth, false, t.width, t.height, t.depthFormat);
+    }
+    t.width = w;
+    t.height = h;
+    t.color = acquire(true, w, h, t.colorFormat);
+    if (t.depthFormat)
+        t.depth = acquire(false, w, h, t.depthFormat);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, t.color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, t.depth);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint RenderTargets::acquire(bool texture, int w, int h, GLenum format) {
+    for (auto it = pool.begin(); it != pool.end(); ++it) {
+        if (it->texture == texture && it->width == w && it->height == h &&
+            it->format == format) {
+            GLuint handle = it->handle;
+            pool.erase(it);
+            return handle;
+        }
+    }
+
+    // Storage is immutable, resizing always takes another attachment
+    GLuint handle;
+    if (texture) {
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D, handle);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, w, h);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    } else {
+        glGenRenderbuffers(1, &handle);
+        glBindRenderbuffer(GL_RENDERBUFFER, handle);
+        glRenderbufferStorage(GL_RENDERBUFFER, format, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+    ++allocated;
+    return handle;
+}
+
+void RenderTargets::release(GLuint handle, bool texture, int w, int h,
+                            GLenum format) {
+    pool.push_back({handle, texture, w, h, format});
+    if (pool.size() > POOL_SIZE) {
+        destroy(pool.front());
+        pool.erase(pool.begin());
+    }
+}
+
+void RenderTargets::destroy(const Attachment& a) {
+    if (a.texture)
+        glDeleteTextures(1, &a.handle);
+    else
+        glDeleteRenderbuffers(1, &a.handle);
+    --allocated;
+}
@@ -0,0 +1,68 @@
+#ifndef RENDER_TARGETS_H
+#define RENDER_TARGETS_H
+
+/*
+ * RenderTargets - off-screen framebuffers, and a pool of the textures and
+ * renderbuffers attached to them.
+ *
+ * Each target keeps its framebuffer for good. Resizing one hands its old
+ * attachments back to the pool and takes ones of the new size from it,
+ * only making new ones when none match, so going back to an earlier size
+ * is free. The pool only holds a few attachments nobody uses and deletes
+ * the oldest beyond that, so nothing leaks however often the window is
+ * resized. Everything lives as long as the GL context does, like the
+ * renderer's other objects.
+ */
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#endif
+
+#include <vector>
+
+struct RenderTarget {
+    GLuint fbo;
+    GLuint color; // Texture, to sample from afterwards
+    GLuint depth; // Renderbuffer, 0 if the target has none
+    int width, height;
+    GLenum colorFormat, depthFormat;
+};
+
+class RenderTargets {
+public:
+    RenderTargets() {}
+    RenderTargets(const RenderTargets&) = delete;
+    void operator=(const RenderTargets&) = delete;
+
+    // Make a target of the given size and (sized, internal) formats.
+    // depthFormat 0 makes one with no depth. Returns its index.
+    int create(int w, int h, GLenum colorFormat, GLenum depthFormat = 0);
+    // Give a target attachments of the new size, unless it already has
+    void resize(int target, int w, int h);
+    const RenderTarget& get(int target) const { return targets[target]; }
+
+    // Attachments made and still alive, pooled or not
+    int getAllocated() const { return allocated; }
+
+private:
+    struct Attachment {
+        GLuint handle;
+        bool texture; // Else renderbuffer
+        int width, height;
+        GLenum format;
+    };
+
+    std::vector<RenderTarget> targets;
+    std::vector<Attachment> pool; // Unused, oldest first
+    int allocated = 0;
+
+    // Take a matching attachment from the pool, or make one
+    GLuint acquire(bool texture, int w, int h, GLenum format);
+    // Put an attachment back in the pool, deleting the oldest if full
+    void release(GLuint handle, bool texture, int w, int h, GLenum format);
+    void destroy(const Attachment& a);
+};
+
+#endif
@@ -6,9 +6,17 @@
 #include <vector>
 #include <cstdlib>
 #include <map>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <chrono>
+#include <limits>
 
 #include "cube_vertices.h"
 #include "minimap.h"
+#include "frustum.h"
+#include "mesher.h"
+#include "noise.h"
 
 static void display();
 static void reshape(int w, int h);
@@ -19,131 +27,377 @@ Renderer& Renderer::getInstance() {
     return instance;
 }
 
+// Milliseconds since first called. GLUT's clock is only there with a
+// window.
+static int elapsed() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
 void Renderer::start(World* w, int sW, int sH) {
-    projection = glm::perspective(
-        glm::radians(60.0f), 
-        (float) sW / 
-        (float) sH,
-        0.01f,
-        10.0f);
+    setup(w, sW, sH);
+    glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutIdleFunc(idle);
+    glutMainLoop();
+}
+
+void Renderer::startOffscreen(World* w, int sW, int sH) {
+    screenTarget = targets.create(sW, sH, GL_RGB8, GL_DEPTH24_STENCIL8);
+    screenFBO = targets.get(screenTarget).fbo;
+    setup(w, sW, sH);
+}
+
+void Renderer::setup(World* w, int sW, int sH) {
     world = w;
+    if (world->getTargetFps() > 0)
+        scaler = ResolutionScaler(1000.0f / world->getTargetFps());
+    lastTime = elapsed();
     genMinimap();
-    glutMainLoop();
+    reshapeCall(sW, sH);
+}
+
+// The world is left to whoever is calling to advance
+void Renderer::drawOffscreen(float time,
+                             std::vector<unsigned char>* pixels) {
+    fixedTime = time;
+    if (world->getMinimap().needsUpdate())
+        updateMinimap();
+    displayCall();
+    if (!pixels) {
+        glFinish();
+        return;
+    }
+
+    // GL's rows go from the bottom up
+    const size_t row = 3 * screenW;
+    std::vector<unsigned char> flipped(row * screenH);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, screenFBO);
+    glReadPixels(0, 0, screenW, screenH, GL_RGB, GL_UNSIGNED_BYTE,
+                 flipped.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    pixels->resize(flipped.size());
+    for (int y = 0; y < screenH; ++y)
+        std::copy(flipped.begin() + (screenH - 1 - y) * row,
+                  flipped.begin() + (screenH - y) * row,
+                  pixels->begin() + y * row);
+}
+
+// Vertical field of view, degrees
+static const float FOV = 60.0f;
+
+// Far plane is the view distance, nothing past it is drawn anyway
+void Renderer::updateProjection() {
+    farPlane = world->getViewDistance();
+    projection = glm::perspective(glm::radians(FOV), aspect, 0.01f,
+                                  farPlane);
+}
+
+// Tiles from the camera a drawn fragment can be, out to the corners of
+// the far plane
+int Renderer::lightReach() {
+    const float up = tanf(glm::radians(FOV) / 2), across = up * aspect;
+    return (int) ceilf(farPlane * sqrtf(1 + up*up + across*across)) + 1;
 }
 
 void Renderer::displayCall() {
-    drawToFramebuffer();
-    drawScene();
-    glutSwapBuffers();
+    auto start = std::chrono::steady_clock::now();
+    const bool timed = world->getTargetFps() > 0;
+    if (timed)
+        beginFrameTimer();
+    updateFrame();
+
+    // Only the fade or a lowered resolution need a postprocessing pass,
+    // the rest of the time the scene is drawn straight to the screen
+    const bool scaled = sceneSize != glm::ivec2(screenW, screenH);
+    if (frame.brightness < 1.0f || scaled) {
+        glViewport(0, 0, sceneSize.x, sceneSize.y);
+        drawToFramebuffer(targets.get(sceneTarget).fbo);
+        glViewport(0, 0, screenW, screenH);
+        drawScene();
+    } else {
+        drawToFramebuffer(screenFBO);
+    }
+    // Always at the window's resolution, over the scene
+    if (world->getMinimap().enabled())
+        drawMinimap();
+
+    if (timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        frameCpu[(queryFrame - 1) % FRAME_QUERIES] =
+            std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void Renderer::beginFrameTimer() {
+    // The query was last used FRAME_QUERIES frames ago. Its frame is
+    // counted as however long the slower of the CPU and GPU took on it.
+    // The very first frame waits on everything set up before it, and
+    // some drivers (llvmpipe) time it as hours, so it isn't counted.
+    const int slot = queryFrame % FRAME_QUERIES;
+    if (queryFrame > FRAME_QUERIES) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(frameQueries[slot], GL_QUERY_RESULT_NO_WAIT,
+                              &ns);
+        const float before = scaler.getScale();
+        if (ns > 0)
+            scaler.frame(std::max(ns / 1.0e6f, frameCpu[slot]));
+        if (scaler.getScale() != before && world->showsStats())
+            std::cout << "Resolution scale " << scaler.getScale()
+                << ", frames taking " << scaler.getAverage() << "ms\n";
+    }
+    glBeginQuery(GL_TIME_ELAPSED, frameQueries[slot]);
+    ++queryFrame;
+}
+
+void Renderer::updateFrame() {
+    if (world->getViewDistance() != farPlane)
+        updateProjection();
+    auto& m = world->getMaze();
+    frame.view = world->getView();
+    frame.projection = projection;
+    frame.lightPos = glm::vec4(world->getPos(), 1.7f, 1.0f);
+    frame.endPos = glm::vec4(m.getEnd(), 1.7f, 1.0f);
+    frame.time = fixedTime >= 0 ? fixedTime : elapsed();
+    // Postprocessing effect - fade out when player has reached end of
+    // maze and back in once the world resets it
+    frame.brightness = world->getBrightness();
+    // Shadow size changes with screen size
+    frame.shadowSize = world->getMinimap().getShadowSize();
+
+    // Noise can be switched between baked and worked out per fragment,
+    // with --stats report how long frames took with the one switched
+    // away from
+    const GLfloat baked = world->usesBakedNoise() ? 1.0f : 0.0f;
+    int now = elapsed();
+    if (baked != frame.bakedNoise && noiseFrames > 0) {
+        if (world->showsStats())
+            std::cout << (frame.bakedNoise ? "Baked" : "Per fragment")
+                << " noise: " << (float) (now - noiseSince) / noiseFrames
+                << "ms a frame over " << noiseFrames << " frames\n";
+        noiseFrames = 0;
+        noiseSince = now;
+    }
+    frame.bakedNoise = baked;
+    ++noiseFrames;
+
+    const glm::vec2 screen(screenW, screenH);
+    sceneSize = glm::max(glm::ivec2(screen * scaler.getScale() + 0.5f),
+                         glm::ivec2(1));
+    frame.sceneScale = glm::vec2(sceneSize) / screen;
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void Renderer::idleCall() {
-    world->tick();
+    int now = elapsed();
+    world->advance((now - lastTime) / 1000.0f);
+    lastTime = now;
     if (world->getMinimap().needsUpdate())
         updateMinimap();
     glutPostRedisplay();
 }
 
-void Renderer::drawMaze() {
+// Uniform buffer binding of the frame uniforms, as in frame.glsl
+static const GLuint FRAME_BINDING = 0;
+// Noise volume, in samples, and samples per tile. Repeats every 16 x 16 x
+// 8 tiles, as in maze.frag.
+static const int NOISE_SIZE = 128;
+static const int NOISE_DEPTH = 64;
+static const int NOISE_PER_TILE = 8;
+// Tiles per side of a render chunk
+static const int RENDER_CHUNK = 16;
+// Most bytes of instances baked into the buffer, well short of where
+// allocating them would fail or a 32 bit base instance would overflow
+static const size_t INSTANCE_BUDGET = (size_t) 1 << 30;
+// Storage buffer bindings of the lights, their cells and the lights in
+// each, as in maze.frag
+static const GLuint LIGHTS_BINDING = 1;
+// Tiles per side of a light cell, and tiles spare around what the view
+// can reach that lights are binned over, so walking doesn't rebin them
+// every step
+static const int LIGHT_CELL = 4;
+static const int LIGHT_SLACK = 8;
+// Height of the walls above the floor, as in maze.vert
+static const float FLOOR_Z = 0.5f;
+static const float WALL_HEIGHT = 5.0f;
+
+void Renderer::bakeMaze(glm::ivec2 lo, glm::ivec2 hi) {
     auto& m = world->getMaze();
-    auto& grid = m.getGrid();
-    auto view = world->getView();
-    auto pos = world->getPos();
-
-    const int gridSizeX = grid.size();
-    const int gridSizeY = grid[0].size();
-
-    const int rSize = 10;
-    // Representing the bound of tiles to render - rSize square around
-    // camera
-    const int lowerX = (int) pos.x >= rSize ? (int) pos.x - rSize : 0;
-    const int upperX = (int) pos.x < gridSizeX - rSize ? 
-                       (int) pos.x + rSize : gridSizeX - 1;
-    const int lowerY = (int) pos.y >= rSize ? (int) pos.y - rSize : 0;
-    const int upperY = (int) pos.y < gridSizeY - rSize ?
-                       (int) pos.y + rSize : gridSizeY - 1;
-
-    mazeShader.use();
-    glm::vec3 normal;
-    /* Supply uniforms to shader for lighting */
-    GLuint nLoc = glGetUniformLocation(mazeShader.program, "normal");
-    GLuint lLoc = glGetUniformLocation(mazeShader.program, "lightPos");
-    glUniform3fv(lLoc, 1, glm::value_ptr(glm::vec3(pos, 1.7f)));
-    GLuint eLoc = glGetUniformLocation(mazeShader.program, "endPos");
-    glUniform3fv(eLoc, 1, glm::value_ptr(glm::vec3(m.getEnd(), 1.7f)));
-    GLuint tLoc = glGetUniformLocation(mazeShader.program, "time");
-    glUniform1i(tLoc, glutGet(GLUT_ELAPSED_TIME));
-
-    for (int i = lowerX; i <= upperX; ++i) {
-        for (int j = lowerY; j <= upperY; ++j) {
-            /* Rendering walls */
-            if (grid[i][j].type == Type::Wall)
-                continue;
-            // Every wall face at current tile
-            std::vector<int> faces = m.facesAt(i, j);
-
-            // Set face's position according to tile positions
-            glm::mat4 model;
-            model = glm::translate(model, glm::vec3(0.5f, 0.5f, 0.0f));
-            model = glm::translate(model, 
-                ((float) 1.0f) * glm::vec3((float) i, (float) j, 1.0f));
-
-            // Bind appropriate texture, VAO and set normal for face
-            glBindTexture(GL_TEXTURE_2D, textures[0]);
-            for (auto& f : faces) {
-                switch (m.mesh[f].dir) {
-                    case Dir::North:
-                        normal = glm::vec3(0.0f, 1.0f, 0.0f);
-                        setModel(Model::South);
-                        break;
-                    case Dir::East:
-                        normal = glm::vec3(1.0f, 0.0f, 0.0f);
-                        setModel(Model::West);
-                        break;
-                    case Dir::South:
-                        normal = glm::vec3(0.0f, -1.0f, 0.0f);
-                        setModel(Model::North);
-                        break;
-                    case Dir::West:
-                        normal = glm::vec3(-1.0f, 0.0f, 0.0f);
-                        setModel(Model::East);
-                        break;
-                }
-                glUniform3fv(nLoc, 1, glm::value_ptr(normal));
-
-                glm::mat4 upperWalls = model;
-                glm::vec3 offset = {0.0f, 0.0f, 1.0f};
-                for (int i = 0; i < 5; ++i) {
-                    mazeShader.updateMVP(upperWalls, view, projection);
-                    glDrawArrays(GL_TRIANGLES, 0, 6);
-                    upperWalls = glm::translate(upperWalls, offset);
+    auto open = [&m](int x, int y) {
+        return m.getTile(x, y).type != Type::Wall;
+    };
+    std::vector<FaceRun> runs;
+    const size_t maxInstances = INSTANCE_BUDGET / sizeof(MazeInstance);
+    instances.clear();
+    chunks.clear();
+    const int chunksW = (hi.x - lo.x + RENDER_CHUNK - 1) / RENDER_CHUNK;
+    const int chunksH = (hi.y - lo.y + RENDER_CHUNK - 1) / RENDER_CHUNK;
+    chunkSlot.assign(chunksW * chunksH, -1);
+    bool full = false;
+    for (int cy = lo.y; cy < hi.y && !full; cy += RENDER_CHUNK) {
+        for (int cx = lo.x; cx < hi.x && !full; cx += RENDER_CHUNK) {
+            RenderChunk c;
+            c.first = instances.size();
+            const int endX = std::min(cx + RENDER_CHUNK, hi.x);
+            const int endY = std::min(cy + RENDER_CHUNK, hi.y);
+            // Floor in runs along each row, walls in runs of faces
+            for (int j = cy; j < endY; ++j) {
+                for (int i = cx; i < endX; ++i) {
+                    if (!open(i, j))
+                        continue;
+                    int start = i;
+                    while (i + 1 < endX && open(i + 1, j))
+                        ++i;
+                    instances.push_back({(GLfloat) start, (GLfloat) j, 4.0f,
+                                         (GLfloat) (i + 1 - start)});
                 }
             }
+            runs.clear();
+            meshFaces(open, cx, cy, endX, endY, runs);
+            for (const FaceRun& r : runs)
+                instances.push_back({(GLfloat) r.x, (GLfloat) r.y,
+                                     (GLfloat) r.dir, (GLfloat) r.length});
+            // Chunks past what can be drawn are left out, the maze is
+            // only drawn up to them
+            if (instances.size() > maxInstances) {
+                instances.resize(c.first);
+                std::cerr << "Maze too big to bake whole within "
+                    << (INSTANCE_BUDGET >> 20) << "MB, only drawing "
+                    << chunks.size() << " chunks of it\n";
+                full = true;
+                break;
+            }
+            c.count = instances.size() - c.first;
+            c.min = glm::vec3(cx, cy, FLOOR_Z);
+            c.max = glm::vec3(endX, endY, FLOOR_Z + WALL_HEIGHT);
+            if (c.count > 0) {
+                chunkSlot[(cy - lo.y) / RENDER_CHUNK * chunksW +
+                          (cx - lo.x) / RENDER_CHUNK] = chunks.size();
+                chunks.push_back(c);
+            }
+        }
+    }
+    bakedMin = lo;
+    bakedMax = hi;
+    bakedVersion = m.getVersion();
+
+    // Fixed mazes are baked whole from (0, 0), so the PVS's chunks line
+    // up with the baked ones. Built out to the furthest the view
+    // distance can go.
+    pvs.clear();
+    if (world->usesPvs() && !m.isEndless()) {
+        int start = elapsed();
+        pvs.build(m, RENDER_CHUNK, MAX_VIEW_DISTANCE,
+                  std::max(1u, std::thread::hardware_concurrency()));
+        if (world->showsStats())
+            std::cout << "PVS: " << pvs.getSets() << " distinct sets, "
+                << pvs.getAverage() << " of " << chunks.size()
+                << " chunks visible from a tile on average, took "
+                << elapsed() - start << "ms\n";
+    }
 
-            /* Rendering floors */
-            setModel(Model::Floor);
-            glBindTexture(GL_TEXTURE_2D, textures[1]);
-            model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f));
-            mazeShader.updateMVP(model, view, projection);
-            normal = glm::vec3(0.0f, 0.0f, 1.0f);
-            glUniform3fv(nLoc, 1, glm::value_ptr(normal));
+    glBindBuffer(GL_ARRAY_BUFFER, mazeVBOs[1]);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(MazeInstance),
+                 instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::drawMaze() {
+    auto& m = world->getMaze();
+    auto pos = world->getPos();
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Fixed mazes are baked whole. Endless ones only have the chunks
+    // around the player, which are baked whenever the player moves to
+    // another chunk or they change.
+    glm::ivec2 lo(0, 0), hi(m.getWidth(), m.getHeight());
+    if (m.isEndless()) {
+        glm::ivec2 chunk = glm::max(glm::ivec2(pos) - 1, glm::ivec2(0)) /
+            CHUNK_TILES;
+        lo = glm::max((chunk - 1) * CHUNK_TILES + 1, glm::ivec2(0));
+        hi = glm::min(lo + 3*CHUNK_TILES, hi);
+    }
+    if (m.getVersion() != bakedVersion || lo != bakedMin)
+        bakeMaze(lo, hi);
+    // Lights are binned over a window of tiles around the camera, and
+    // rebinned once what it can see reaches past it
+    const glm::ivec2 tile(glm::floor(pos));
+    const int reach = lightReach();
+    const glm::ivec2 needLo = glm::max(tile - reach, bakedMin);
+    const glm::ivec2 needHi = glm::min(tile + reach + 1, bakedMax);
+    if (world->getLightsVersion() != binnedLights ||
+        needLo.x < binnedLo.x || needLo.y < binnedLo.y ||
+        needHi.x > binnedHi.x || needHi.y > binnedHi.y)
+        binLights(tile);
+
+    // View, projection and lights come from the frame uniforms
+    mazeShader.use();
 
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, noiseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glBindVertexArray(mazeVAO);
+
+    // Draw chunks in the view frustum (whose far plane is the view
+    // distance). Chunks next to each other in the buffer are drawn
+    // together.
+    Frustum frustum(projection * frame.view);
+    GLuint runFirst = 0;
+    GLsizei runCount = 0;
+    auto draw = [&](const RenderChunk& c) {
+        if (!frustum.intersects(c.min, c.max))
+            return;
+        if (runCount > 0 && runFirst + runCount == c.first &&
+            c.count <= std::numeric_limits<GLsizei>::max() - runCount) {
+            runCount += c.count;
+            return;
         }
+        if (runCount > 0)
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6,
+                                              runCount, runFirst);
+        runFirst = c.first;
+        runCount = c.count;
+    };
+    // Only the chunks that can be seen from the player's tile, if known.
+    // Those come in buffer order too.
+    ChunkRange visible = pvs.visible((int) floorf(pos.x),
+                                     (int) floorf(pos.y));
+    if (!visible.empty()) {
+        for (int id : visible)
+            if (chunkSlot[id] >= 0)
+                draw(chunks[chunkSlot[id]]);
+    } else {
+        for (const RenderChunk& c : chunks)
+            draw(c);
     }
+    if (runCount > 0)
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6,
+                                          runCount, runFirst);
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 /* Drawing portal at end of maze */
 void Renderer::drawExit() {
-    auto& grid = world->getMaze().getGrid();
-    auto view = world->getView();
+    auto& m = world->getMaze();
+    // Endless mazes have no exit
+    if (m.isEndless())
+        return;
     auto pos = world->getPos();
-    const int gridSizeX = grid.size();
-    const int gridSizeY = grid[0].size();
+    const int gridSizeX = m.getWidth();
+    const int gridSizeY = m.getHeight();
 
     /* Have to sort each face by distance from player so that *
      * transparency is rendered correctly                     */
@@ -169,8 +423,7 @@ void Renderer::drawExit() {
     // Want faces of portal to be visible from both sides
     glDisable(GL_CULL_FACE);
     portalShader.use();
-    portalShader.updateMVP(model, view, projection);
-    portalShader.setUniform1f("time", glutGet(GLUT_ELAPSED_TIME));
+    portalShader.setUniformMat4(portalModel, model);
     // Loop through in reverse order of distance to render transparency
     // correctly
     for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
@@ -184,7 +437,7 @@ void Renderer::drawExit() {
 
 void Renderer::drawMinimap() {
     setModel(Model::Minimap);
-    glBindTexture(GL_TEXTURE_2D, textures[2]);
+    glBindTexture(GL_TEXTURE_2D, mapTexture);
     mapShader.use();
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -192,59 +445,30 @@ void Renderer::drawMinimap() {
     glBindVertexArray(0);
 }
 
-/* Draws scene off-screen to a framebuffer */
-void Renderer::drawToFramebuffer() {
+/* Draws scene to a framebuffer, off-screen or the screen's */
+void Renderer::drawToFramebuffer(GLuint fbo) {
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
 
     drawMaze();
     drawExit();
-    if (world->getMinimap().enabled())
-        drawMinimap();
 
     glDisable(GL_DEPTH_TEST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
 }
 
-/* Draws framebuffer to screen */
+/* Draws off-screen scene to screen, faded */
 void Renderer::drawScene() {
-    auto& m = world->getMaze();
     glClear(GL_COLOR_BUFFER_BIT);
     screenShader.use();
 
-    // Postprocessing effect - fade out when player has reached
-    // end of maze, reset maze and fade back in after a set time
-    // 60 fps, so 5 second fade out and 2.5 second fade in
-    static int endState = 0;
-    if (m.won() || endState != 0) {
-        static float framesSinceWon = 0.0f;
-        if (endState == 0) {
-            screenShader.setUniform1f("time", framesSinceWon);
-            screenShader.setUniform1f("fade", 2.0);
-            ++framesSinceWon;
-            if (framesSinceWon >= 300.0f) {
-                world->reset();
-                framesSinceWon = 0.0f;
-                endState++;
-            }
-        } else if (endState == 1) {
-            screenShader.setUniform1f("time", framesSinceWon);
-            screenShader.setUniform1f("fade", 1.0);
-            framesSinceWon++;
-            if (framesSinceWon >= 150.0f)
-                endState++;
-        } else {
-            screenShader.setUniform1f("fade", 0.0);
-            framesSinceWon = 0;
-            endState = 0;
-        }
-    }
-
     setModel(Model::Screen);
     glDisable(GL_DEPTH_TEST);
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
+    glBindTexture(GL_TEXTURE_2D, targets.get(sceneTarget).color);
+    glBindSampler(0, upscaleSampler);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindSampler(0, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindVertexArray(0);
 }
@@ -281,37 +505,13 @@ inline void Renderer::setModel(Model m) {
     glBindVertexArray(modelMap[m]);
 }
 
-// Framebuffer needs texture & renderbuffer object to be made
-void Renderer::genFramebuffer(int screenW, int screenH) {
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    glGenTextures(1, &screenTexture);
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenW, screenH, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);
-
-    GLuint rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screenW, screenH);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
 Renderer::Renderer() :
         mazeShader("src/shaders/maze.vert", "src/shaders/maze.frag"),
         mapShader("src/shaders/minimap.vert", "src/shaders/minimap.frag"),
         portalShader("src/shaders/end.vert", "src/shaders/end.frag"),
-        screenShader("src/shaders/post.vert", "src/shaders/post.frag")
+        screenShader("src/shaders/post.vert", "src/shaders/post.frag"),
+        lightGrid(LIGHT_CELL)
 {
-    std::vector<std::vector<GLfloat>> models = {north, east, south, west, top};
     vbos.resize(8);
     vaos.resize(8);
     glGenBuffers(vbos.size(), &vbos[0]);
@@ -321,20 +521,80 @@ Renderer::Renderer() :
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glCullFace(GL_BACK);
 
-    genFramebuffer(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+    // Sized for the screen once started
+    screenW = screenH = 1;
+    screenFBO = 0;
+    screenTarget = -1;
+    fixedTime = -1.0f;
+    sceneTarget = targets.create(screenW, screenH, GL_RGB8,
+                                 GL_DEPTH24_STENCIL8);
+    glGenSamplers(1, &upscaleSampler);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenQueries(FRAME_QUERIES, frameQueries);
+    queryFrame = 0;
 
     // Model vertices defined in cube_vertices.h header
     std::unordered_map<Model, int> modelMap;
     registerModel(Model::North, north);
     registerModel(Model::East, east);
-    registerModel(Model::Floor, top);
     registerModel(Model::South, south);
     registerModel(Model::West, west);
     registerModel(Model::Screen, screenQuad);
 
+    // Maze is one unit quad, instanced and stretched for every run of
+    // faces and floor tiles
+    glGenVertexArrays(1, &mazeVAO);
+    glGenBuffers(2, mazeVBOs);
+    glBindVertexArray(mazeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mazeVBOs[0]);
+    glBufferData(GL_ARRAY_BUFFER, quadCorners.size() * sizeof(GLfloat),
+        quadCorners.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat),
+        (GLvoid*) 0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, mazeVBOs[1]);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(MazeInstance),
+        (GLvoid*) 0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // Version 0 is never a real maze's, so first frame bakes it
+    bakedVersion = 0;
+
+    mazeShader.setUniform1i("wallTexture", 0);
+    mazeShader.setUniform1i("floorTexture", 1);
+    mazeShader.setUniform1i("noiseTexture", 2);
+    portalModel = portalShader.location("model");
+    mapShader.setUniform1i("tiles", 0);
+    mapOrigin = mapShader.location("origin");
+    mapPlayer = mapShader.location("player");
+    mapShowPath = mapShader.location("showPath");
+    mapTexture = 0;
+    mapTextureSize = glm::ivec2(0);
+
+    // Frame uniforms are bound once to the binding point frame.glsl uses
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameUBO);
+
+    // Light buffers are filled in when first binned
+    glGenBuffers(3, lightSSBOs);
+    for (int i = 0; i < 3; ++i)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING + i,
+                         lightSSBOs[i]);
+    binnedLights = 0;
+    binnedLo = binnedHi = glm::ivec2(0);
+
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glGenTextures(3, textures);
+    glGenTextures(2, textures);
 
     /* Generating 2 16x16 RGB textures to use for wall and floor */
     int w, h, n;
@@ -361,10 +621,9 @@ Renderer::Renderer() :
     delete[] wall;
     delete[] floor;
 
+    genNoise();
+
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutIdleFunc(idle);
 }
 
 void Renderer::loadTexture(int index, unsigned char* data, int w, int h, bool alpha) {
@@ -387,39 +646,109 @@ void Renderer::loadTexture(int index, unsigned char* data, int w, int h, bool al
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+// Same noise every run, so the walls always look the same
+void Renderer::genNoise() {
+    std::vector<float> noise;
+    bakeNoise(noise, NOISE_SIZE, NOISE_SIZE, NOISE_DEPTH, NOISE_PER_TILE,
+              1, std::max(1u, std::thread::hardware_concurrency()));
+
+    glGenTextures(1, &noiseTexture);
+    glBindTexture(GL_TEXTURE_3D, noiseTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, NOISE_SIZE, NOISE_SIZE,
+                 NOISE_DEPTH, 0, GL_RED, GL_FLOAT, noise.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    noiseFrames = 0;
+    noiseSince = elapsed();
+    frame.bakedNoise = 1.0f;
+}
+
+void Renderer::binLights(glm::ivec2 tile) {
+    const std::vector<PointLight>& lights = world->getLights();
+    const int reach = lightReach() + LIGHT_SLACK;
+    binnedLo = glm::max(tile - reach, bakedMin);
+    binnedHi = glm::min(tile + reach + 1, bakedMax);
+    lightGrid.build(lights, binnedLo, binnedHi);
+
+    // Buffers are never left empty, the shader only reads the lights
+    // cells point it to
+    auto upload = [](GLuint buffer, const void* data, size_t size) {
+        static const uint32_t none = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size ? size : sizeof(none),
+                     size ? data : &none, GL_DYNAMIC_DRAW);
+    };
+    upload(lightSSBOs[0], lights.data(), lights.size() * sizeof(PointLight));
+    const auto& cells = lightGrid.getCells();
+    upload(lightSSBOs[1], cells.data(), cells.size() * sizeof(int32_t));
+    const auto& indices = lightGrid.getIndices();
+    upload(lightSSBOs[2], indices.data(), indices.size() * sizeof(uint32_t));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    binnedLights = world->getLightsVersion();
+}
+
 void Renderer::genMinimap() {
     Minimap& m = world->getMinimap();
     std::vector<GLfloat> verts = m.getVertices();
     registerModel(Model::Minimap, verts);
-    Renderer::loadTexture(2, m.getTexture(), m.getWidth(), m.getHeight(), true);
-    mapShader.setUniform1f("shadowSize", m.getShadowSize());
+    updateMinimap();
 }
 
+// The texture is only made once, after that only the texels of the
+// window that changed are sent
 void Renderer::updateMinimap() {
     Minimap& m = world->getMinimap();
-    Renderer::loadTexture(2, m.getTexture(), m.getWidth(), m.getHeight(), true);
+    const glm::ivec2 size(m.getWidth(), m.getHeight());
+    glBindTexture(GL_TEXTURE_2D, mapTexture);
+    // Integer texture, so nearest filtering only. It repeats, being a
+    // ring around the player.
+    if (size != mapTextureSize) {
+        glDeleteTextures(1, &mapTexture);
+        glGenTextures(1, &mapTexture);
+        glBindTexture(GL_TEXTURE_2D, mapTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, size.x, size.y);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        mapTextureSize = size;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+    for (const glm::ivec4& r : m.getDirty())
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.z, r.w,
+            GL_RED_INTEGER, GL_UNSIGNED_BYTE,
+            m.getTexels() + r.y*size.x + r.x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m.clearDirty();
+
+    mapShader.setUniform2i(mapOrigin, m.getOrigin());
+    mapShader.setUniform2i(mapPlayer, m.getPlayer());
+    mapShader.setUniform1i(mapShowPath, m.showsPath());
 }
 
 void Renderer::reshapeCall(int w, int h) {
     glViewport(0, 0, w, h);
-    projection = glm::perspective(
-        glm::radians(60.0f), 
-        (float) w / 
-        (float) h,
-        0.01f,
-        10.0f);
-    genFramebuffer(w, h);
+    aspect = (float) w / (float) h;
+    updateProjection();
+    screenW = w;
+    screenH = h;
+    targets.resize(sceneTarget, w, h);
     auto& m = world->getMinimap();
     m.reshape(w, h);
     reloadModel(Model::Minimap, m.getVertices());
-    // Need to reload shadow size since it changes with screen size
-    mapShader.setUniform1f("shadowSize", m.getShadowSize());
 }
 
 // GLUT's required static functions
 
 static void display() {
     Renderer::getInstance().displayCall();
+    glutSwapBuffers();
 }
 
 static void reshape(int w, int h) {
@@ -3,6 +3,10 @@
 
 /* 
  * Renderer - handles all OpenGL rendering.
+ *
+ * Draws to a GLUT window from its main loop, or offscreen into a target
+ * of its own, a frame whenever asked, for machines with no display (see
+ * Offscreen). Nothing but start() and the callbacks touch GLUT.
  */
 
 #ifdef __APPLE__
@@ -17,6 +21,10 @@
 
 #include "shader.h"
 #include "world.h"
+#include "pvs.h"
+#include "light_grid.h"
+#include "render_targets.h"
+#include "resolution.h"
 
 /* Simple enum since there aren't many models */
 enum class Model {
@@ -24,11 +32,13 @@ enum class Model {
     East,
     South,
     West,
-    Floor,
     Minimap,
     Screen
 };
 
+// Frames timed on the GPU at once for dynamic resolution
+const static int FRAME_QUERIES = 4;
+
 // Specify hashing a model enum (for std::unordered_map<Model, GLint>)
 namespace std {
     template <>
@@ -48,6 +58,13 @@ public:
 
     /* Start renderer given screen width and screen height */
     void start(World* w, int sW, int sH);
+    /* Start renderer drawing into an offscreen target of sW x sH, *
+     * with no window or GLUT main loop                             */
+    void startOffscreen(World* w, int sW, int sH);
+    /* Draw the world as it is offscreen, at time milliseconds in. If *
+     * pixels isn't null, read the frame into it as RGB rows from the *
+     * top, otherwise just wait for it to be finished.                */
+    void drawOffscreen(float time, std::vector<unsigned char>* pixels);
 
     /* GLUT callbacks call these */
     void displayCall();
@@ -58,23 +75,128 @@ private:
     // Since GLUT handles display/idle as a callback, must call back to
     // the world instance to update everything
     World* world;
+    int lastTime; // Milliseconds, when world was last advanced
+    float fixedTime; // Time frames are drawn at offscreen, -1 for real time
 
     /* Containers of VBOs, VAOs, models */
     std::vector<GLuint> vbos;
     std::vector<GLuint> vaos;
     std::unordered_map<Model, GLint> modelMap;
-    /* Framebuffer to draw to, to do postprocessing on */
-    GLuint fbo;
-    /* Maze textures, and one for whole screen framebuffer */
-    GLuint textures[3];
-    GLuint screenTexture;
+    /* Off-screen framebuffers, and the one the scene is drawn to when *
+     * it needs postprocessing                                         */
+    RenderTargets targets;
+    int sceneTarget;
+    // Filters the scene when scaling it up to the window
+    GLuint upscaleSampler;
+    int screenW, screenH;
+    /* Framebuffer frames end up in - the window's (0), or that of *
+     * screenTarget offscreen                                       */
+    GLuint screenFBO;
+    int screenTarget;
+
+    /* Dynamic resolution - the maze is drawn to part of the scene     *
+     * target, as much as frames have time for. Frames are timed on    *
+     * the GPU with a few queries in turn, so reading one back never   *
+     * waits on the frame just sent.                                   */
+    ResolutionScaler scaler;
+    glm::ivec2 sceneSize; // Pixels the scene is drawn at
+    GLuint frameQueries[FRAME_QUERIES];
+    float frameCpu[FRAME_QUERIES]; // CPU milliseconds of the same frames
+    int queryFrame; // Frames timed, the next query is this mod FRAME_QUERIES
+    /* Maze textures */
+    GLuint textures[2];
+    /* Minimap's ring of texel flags, and the size it was made for */
+    GLuint mapTexture;
+    glm::ivec2 mapTextureSize;
+    // Noise for the maze's normals, baked at startup
+    GLuint noiseTexture;
+    // Frames drawn, and when, since the noise was last switched
+    int noiseFrames;
+    int noiseSince;
+
+    /* Maze baked into world space, one instance of a quad per straight *
+     * run of wall faces or floor tiles, grouped into square render     *
+     * chunks that are culled as a whole. Rebaked whenever the maze's   *
+     * tiles change.                                                   */
+    struct MazeInstance {
+        GLfloat x, y;   // First tile of the run
+        GLfloat kind;   // Dir of a wall face, or 4 for floor
+        GLfloat length; // Tiles, along x for floor and north/south walls
+    };
+    struct RenderChunk {
+        GLuint first; // Instances first up to first + count
+        GLsizei count;
+        glm::vec3 min, max; // Bounding box
+    };
+    std::vector<MazeInstance> instances;
+    std::vector<RenderChunk> chunks;
+    // Index in chunks of each chunk of the baked square, row by row, or
+    // -1 if it had nothing in it
+    std::vector<int> chunkSlot;
+    // What can be seen from each tile, if asked for, in the same chunks
+    Pvs pvs;
+    glm::ivec2 bakedMin;       // First tile baked
+    glm::ivec2 bakedMax;       // One past the last
+    uint64_t bakedVersion;
+    GLuint mazeVAO;
+    GLuint mazeVBOs[2];        // Quad corners, instances
 
     Shader mazeShader;   // Shader for walls, floors of maze
     Shader mapShader;    // for minimap
     Shader portalShader; // for end blue portal
     Shader screenShader; // for screen framebuffer (for fade effect)
+    GLint portalModel;   // Location of portal's model matrix
+    GLint mapOrigin;     // Locations of minimap's window, player and
+    GLint mapPlayer;     // path toggle
+    GLint mapShowPath;
+
+    /* Everything the shaders need that changes from frame to frame, in *
+     * one std140 uniform buffer (frame.glsl) they all share, uploaded   *
+     * once a frame                                                      */
+    struct FrameUniforms {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 lightPos;
+        glm::vec4 endPos;
+        GLfloat time;
+        GLfloat brightness;
+        GLfloat shadowSize;
+        GLfloat bakedNoise;
+        glm::vec2 sceneScale;
+        GLfloat pad[2]; // std140 rounds the block up to 16 bytes
+    };
+    FrameUniforms frame;
+    GLuint frameUBO;
+
+    /* The world's point lights binned into cells over the baked tiles *
+     * around the camera, in storage buffers for the maze shader:      *
+     * lights, cells, indices. Rebinned when the lights change or the  *
+     * camera can see past the tiles binned.                          */
+    LightGrid lightGrid;
+    GLuint lightSSBOs[3];
+    uint64_t binnedLights; // Lights version binned
+    glm::ivec2 binnedLo;   // Tiles binned over, [binnedLo, binnedHi)
+    glm::ivec2 binnedHi;
 
     glm::mat4 projection;
+    float aspect;
+    float farPlane; // View distance projection was made for
+
+    // Set up for drawing the world to a screen of sW x sH
+    void setup(World* w, int sW, int sH);
+    // Remake projection for the world's current view distance
+    void updateProjection();
+    // Fill in and upload this frame's uniforms
+    void updateFrame();
+    // Bake noise into noiseTexture
+    void genNoise();
+    // Bin the world's lights over the baked tiles around tile and
+    // upload them
+    void binLights(glm::ivec2 tile);
+    // Tiles from the camera anything drawn can be
+    int lightReach();
+    // Start timing a frame, and feed the oldest timed one to the scaler
+    void beginFrameTimer();
 
     Renderer(); // Renderer is singleton, so private constructor
 
@@ -84,17 +206,18 @@ private:
     void registerModel(Model m, std::vector<GLfloat> data);
     // Reload model's vertices
     void reloadModel(Model m, std::vector<GLfloat> data);
-    // Generate framebuffer to off-screen render to
-    void genFramebuffer(int screenW, int screenH);
     // Set up VAO/VBO/texture for minimap
     void genMinimap();
-    // Reload minimap's texture if it needs updating
+    // Send the parts of the minimap's texture that changed
     void updateMinimap();
     // Set current VAO to one mapped to by modelMap
     void setModel(Model m);
 
+    // Bake the tiles in [lo, hi) of the maze into instances
+    void bakeMaze(glm::ivec2 lo, glm::ivec2 hi);
+
     // For actually rendering the scene
-    void drawToFramebuffer();
+    void drawToFramebuffer(GLuint fbo);
     void drawMaze();
     void drawExit();
     void drawMinimap();
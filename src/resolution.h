@@ -0,0 +1,73 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+/*
+ * ResolutionScaler - picks how much of the window's resolution to draw
+ * the maze at, so frames stay within a time budget. Purely header since
+ * it is so small.
+ *
+ * Frame times are smoothed, then the scale drops as soon as they go over
+ * budget and creeps back up once they are comfortably under it. Pixels
+ * go with the square of the scale, so it moves by the square root of how
+ * far off the budget frames are. It only changes in steps and settles for
+ * a few frames after each, since the frames timed just after a change
+ * were drawn at the old scale.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+// Frames to wait after changing scale, and how much it changes by
+const static int SETTLE_FRAMES = 10;
+const static float SCALE_STEP = 1.0f / 16.0f;
+// Weight of the newest frame in the average
+const static float SMOOTHING = 0.1f;
+// Only scale up when frames take under this much of the budget
+const static float HEADROOM = 0.75f;
+
+class ResolutionScaler {
+public:
+    // Aim for frames of budget milliseconds, at no less than minScale of
+    // the window's resolution
+    ResolutionScaler(float budget = 0.0f, float minScale = 0.5f) :
+        budget(budget), minScale(minScale), scale(1.0f), average(0.0f),
+        settle(0) {}
+
+    // Feed the time one frame took, in milliseconds
+    void frame(float ms) {
+        average = average == 0.0f ? ms : average + SMOOTHING*(ms - average);
+        if (budget <= 0.0f)
+            return;
+        if (settle > 0) {
+            --settle;
+            return;
+        }
+        // Only whole steps, so it doesn't flicker between near sizes
+        float target;
+        if (average > budget)
+            target = std::min(scale - SCALE_STEP, std::floor(scale *
+                std::sqrt(budget / average) / SCALE_STEP) * SCALE_STEP);
+        else if (average < HEADROOM * budget)
+            target = scale + SCALE_STEP;
+        else
+            return;
+        target = std::max(minScale, std::min(1.0f, target));
+        if (target != scale) {
+            scale = target;
+            settle = SETTLE_FRAMES;
+        }
+    }
+
+    float getScale() const { return scale; }
+    // Smoothed frame time, milliseconds
+    float getAverage() const { return average; }
+
+private:
+    float budget;
+    float minScale;
+    float scale;
+    float average;
+    int settle;
+};
+
+#endif
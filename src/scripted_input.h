@@ -0,0 +1,83 @@
+#ifndef SCRIPTED_INPUT_H
+#define SCRIPTED_INPUT_H
+
+/*
+ * ScriptedInput - input given by code rather than a keyboard and mouse,
+ * so the world can run without a window. Purely header since it is so
+ * small.
+ */
+
+#include <map>
+
+#include "input.h"
+
+class ScriptedInput : public Input {
+public:
+    ScriptedInput() : scroll(0) {}
+    ~ScriptedInput() {}
+
+    void press(unsigned char key) {
+        if (!keys[key])
+            keys[key] = just[key] = true;
+    }
+
+    void release(unsigned char key) {
+        keys[key] = just[key] = false;
+    }
+
+    void setBtn(Mouse btn, bool down) {
+        buttons[btn] = down;
+    }
+
+    // Move the mouse by offset pixels, as if from the middle of a window
+    void move(glm::vec2 offset) {
+        movement += offset;
+    }
+
+    void wheel(int notches) {
+        scroll += notches;
+    }
+
+    bool getKey(unsigned char key) {
+        return keys[key];
+    }
+
+    bool getJust(unsigned char key) {
+        bool result = just[key];
+        just[key] = false;
+        return result;
+    }
+
+    bool getBtn(Mouse btn) {
+        return buttons[btn];
+    }
+
+    bool hasMoved() {
+        return movement.x != 0 || movement.y != 0;
+    }
+
+    glm::vec2 getMousePos() {
+        return glm::vec2();
+    }
+
+    glm::vec2 getMovement() {
+        glm::vec2 offset = movement;
+        movement = glm::vec2();
+        return offset;
+    }
+
+    int getScroll() {
+        int notches = scroll;
+        scroll = 0;
+        return notches;
+    }
+
+private:
+    std::map<unsigned char, bool> keys;
+    std::map<unsigned char, bool> just;
+    std::map<Mouse, bool> buttons;
+    glm::vec2 movement;
+    int scroll;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+/*
+ * Settings - options given on the command line, handed to the world
+ * and renderer.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "generator.h"
+
+struct Settings {
+    /* Maze size in cells */
+    int mazeW = 10;
+    int mazeH = 10;
+    /* Maze generation - same seed, algorithm and thread count always *
+     * gives the same mazes                                            */
+    Algorithm algorithm = Algorithm::Backtracker;
+    uint64_t seed = 0;
+    int threads = 1;
+    /* Endless streamed maze instead of one with an exit */
+    bool endless = false;
+    /* Simulation ticks per second, independent of frame rate */
+    int tickRate = 60;
+    /* How far away, in tiles, the maze is drawn - can be changed *
+     * while playing                                               */
+    float viewDistance = 10.0f;
+    /* Precompute what can be seen from each tile and only draw that, *
+     * takes a while for big mazes. Not used for endless ones.          */
+    bool pvs = false;
+    /* Print how long things took and what they found as they happen */
+    bool stats = false;
+    /* Torches lighting random spots of each (fixed) maze */
+    int torches = 0;
+    /* Frame rate to drop the maze's resolution to keep up, 0 for off */
+    int targetFps = 0;
+    /* Tick the world this many times with no window, as fast as it *
+     * goes, instead of playing                                       */
+    bool headless = false;
+    long ticks = 100000;
+    /* Draw this many frames with no window, from cameraPath if given *
+     * (otherwise wandering as headless), writing them into outDir as *
+     * PPMs if given                                                   */
+    bool offscreen = false;
+    int frames = 300;
+    std::string cameraPath;
+    std::string outDir;
+};
+
+#endif
@@ -6,12 +6,17 @@
  * wrapper that works and I do not do anything so crazy with shaders that I
  * need anything more complex. Loads shader from file, compiles and provides
  * use function, and some functions to set uniforms for convenience.
+ *
+ * Uniform locations are all looked up once after linking, so setting
+ * them never goes through strings. Anything that changes every frame
+ * lives in the Frame uniform block (frame.glsl) instead.
  */
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 #include <GL/glew.h>
 
@@ -24,24 +29,8 @@ public:
     GLuint program;
 
     Shader(const GLchar* vPath, const GLchar* fPath) {
-        std::string vCodeStr, fCodeStr;
-        std::ifstream vFile, fFile;
-        vFile.exceptions(std::ifstream::badbit);
-        fFile.exceptions(std::ifstream::badbit);
-
-        try {
-            vFile.open(vPath);
-            fFile.open(fPath);
-            std::stringstream vStream, fStream;
-            vStream << vFile.rdbuf();
-            fStream << fFile.rdbuf();
-            vFile.close();
-            fFile.close();
-            vCodeStr = vStream.str();
-            fCodeStr = fStream.str();
-        } catch (std::ifstream::failure e) {
-            std::cerr << "Failed to load shader files\n";
-        }
+        std::string vCodeStr = load(vPath);
+        std::string fCodeStr = load(fPath);
 
         const GLchar* vCode = vCodeStr.c_str();
         const GLchar* fCode = fCodeStr.c_str();
@@ -65,28 +54,92 @@ public:
 
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        findUniforms();
     }
 
     void use() {
         glUseProgram(program);
     }
 
-    void setUniform1f(std::string uniformName, float val) {
-        glUseProgram(program);
-        GLint uniLoc = glGetUniformLocation(program, uniformName.c_str());
-        glUniform1f(uniLoc, val);
+    // Location of a uniform outside any block, found once at link time.
+    // -1 (which setting ignores) if there is none by that name, as when
+    // the compiler optimised it out.
+    GLint location(const std::string& uniformName) const {
+        auto it = locations.find(uniformName);
+        return it != locations.end() ? it->second : -1;
+    }
+
+    // Set straight on the program, so it doesn't need to be in use
+    void setUniform1f(GLint loc, float val) {
+        glProgramUniform1f(program, loc, val);
+    }
+
+    void setUniform1i(GLint loc, int val) {
+        glProgramUniform1i(program, loc, val);
+    }
+
+    void setUniform2i(GLint loc, const glm::ivec2& val) {
+        glProgramUniform2i(program, loc, val.x, val.y);
+    }
+
+    void setUniformMat4(GLint loc, const glm::mat4& val) {
+        glProgramUniformMatrix4fv(program, loc, 1, GL_FALSE,
+                                  glm::value_ptr(val));
     }
 
-    void updateMVP(glm::mat4 model, glm::mat4 view, glm::mat4 proj) {
-        GLint modelLoc = glGetUniformLocation(program, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        GLint viewLoc = glGetUniformLocation(program, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        GLint projLoc = glGetUniformLocation(program, "projection");
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(proj));
+    // By name, for setting things up rather than every frame
+    void setUniform1f(const std::string& uniformName, float val) {
+        setUniform1f(location(uniformName), val);
+    }
+
+    void setUniform1i(const std::string& uniformName, int val) {
+        setUniform1i(location(uniformName), val);
     }
 
 private:
+    std::unordered_map<std::string, GLint> locations;
+
+    // Read a shader's source, replacing #include "file" lines with the
+    // file's contents (from the same directory) since GLSL has none
+    static std::string load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Failed to load shader file " << path << '\n';
+            return "";
+        }
+        const std::string dir = path.substr(0, path.find_last_of('/') + 1);
+        std::stringstream code;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, 10, "#include \"") == 0)
+                code << load(dir + line.substr(10, line.rfind('"') - 10));
+            else
+                code << line << '\n';
+        }
+        return code.str();
+    }
+
+    void findUniforms() {
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            GLchar name[256];
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type,
+                               name);
+            // Members of blocks have no location of their own
+            GLint loc = glGetUniformLocation(program, name);
+            if (loc < 0)
+                continue;
+            // Arrays are named after their first element
+            std::string key = name;
+            if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+                key.erase(key.size() - 3);
+            locations[key] = loc;
+        }
+    }
+
     void compileShader(GLuint& handle, const GLchar* code, GLenum type) {
         GLint success;
         GLchar infoLog[512];
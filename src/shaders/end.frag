@@ -6,7 +6,7 @@ in vec3 pos;
 
 out vec4 color;
 
-uniform float time;
+#include "frame.glsl"
 
 // Pseudo-RNG function pulled from some corner of the internet that seems
 // to be common, not perfect but works fine (I did not make this) - 
@@ -7,8 +7,8 @@ layout (location = 0) in vec3 position;
 out vec3 pos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "frame.glsl"
 
 void main()
 {
@@ -0,0 +1,14 @@
+// Uniforms shared by every program, updated once a frame by the
+// renderer. Must match FrameUniforms in renderer.h.
+layout (std140, binding = 0) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;    // Player's light, xyz
+    vec4 endPos;      // Exit portal's light, xyz
+    float time;       // Milliseconds since start
+    float brightness; // Fade out/in, 0-1
+    float shadowSize; // Minimap drop shadow, in texture coordinates
+    float bakedNoise; // 1 to look noise up in the baked texture, 0 to
+                      // work it out per fragment
+    vec2 sceneScale;  // Part of the scene target the scene is drawn to
+};
@@ -3,13 +3,38 @@
 in vec2 TexCoord;
 in vec3 FragPos;
 in vec3 nNormal;
+flat in int isFloor;
 
 out vec4 color;
 
-uniform sampler2D ourTexture;
-uniform vec3 lightPos;
-uniform vec3 endPos;
-uniform int time;
+uniform sampler2D wallTexture;
+uniform sampler2D floorTexture;
+// Noise baked at startup, repeating every NOISE_PERIOD tiles (as in
+// renderer.cpp)
+uniform sampler3D noiseTexture;
+const vec3 NOISE_PERIOD = vec3(16.0, 16.0, 8.0);
+
+#include "frame.glsl"
+
+// The world's point lights, binned into square cells of tiles around
+// the camera (as in light_grid.h), so each fragment only shades the
+// lights that reach its cell
+struct PointLight {
+    vec4 posRadius; // Radius in tiles, nothing past it is lit
+    vec4 color;
+};
+layout(std430, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+layout(std430, binding = 2) readonly buffer LightCells {
+    ivec2 cellOrigin; // First tile of the first cell
+    ivec2 cellCount;
+    int cellTiles;
+    uvec2 cells[];    // First index and count of lights, row by row
+};
+layout(std430, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
 
 /*****************************************************************/
 /* Forward declarations for 3D perlin noise *that I did not make* -
@@ -40,24 +65,53 @@ vec3 ptLight(vec3 lPos, vec3 lColor, vec3 normal, vec3 fragPos, vec3 viewDir, fl
     return ambient + diffuse + specular;
 }
 
+// As ptLight, faded smoothly to nothing at the light's radius
+vec3 cellLight(PointLight l, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    float d = length(l.posRadius.xyz - fragPos) / l.posRadius.w;
+    if (d >= 1.0)
+        return vec3(0.0);
+    float window = (1.0 - d*d) * (1.0 - d*d);
+    return window * ptLight(l.posRadius.xyz, l.color.rgb, normal, fragPos,
+                            viewDir, 1.0, 0.35, 0.44);
+}
+
+// Every light reaching the cell fragPos is in
+vec3 cellLights(vec3 normal, vec3 fragPos, vec3 viewDir) {
+    ivec2 cell = (ivec2(floor(fragPos.xy)) - cellOrigin) / cellTiles;
+    if (any(lessThan(fragPos.xy, vec2(cellOrigin))) ||
+        any(greaterThanEqual(cell, cellCount)))
+        return vec3(0.0);
+    uvec2 range = cells[cell.y * cellCount.x + cell.x];
+    vec3 result = vec3(0.0);
+    for (uint i = range.x; i < range.x + range.y; ++i)
+        result += cellLight(lights[lightIndices[i]], normal, fragPos,
+                            viewDir);
+    return result;
+}
+
 void main()
 {
-    // Offset face normals with 3D perlin noise
-    vec3 rNormal = normalize((0.3 * cnoise(1.0*FragPos)) + nNormal);
+    // Offset face normals with 3D perlin noise, baked or worked out here
+    float noise = bakedNoise != 0.0 ?
+        texture(noiseTexture, FragPos / NOISE_PERIOD).r :
+        cnoise(1.0*FragPos);
+    vec3 rNormal = normalize((0.3 * noise) + nNormal);
 
     // Render two lights - one coming from player, another pulsating
     // over time coming from the cyan end portal
-    vec3 viewDir = normalize(lightPos - FragPos);
-    vec3 result = ptLight(lightPos, vec3(1), rNormal, FragPos, 
+    vec3 viewDir = normalize(lightPos.xyz - FragPos);
+    vec3 result = ptLight(lightPos.xyz, vec3(1), rNormal, FragPos, 
                           viewDir, 1.0, 0.14, 0.07);
 
     // Modify light color over time to create a pulsating effect
-    result += ptLight(endPos, 
+    result += ptLight(endPos.xyz, 
             2.0*(1.0-0.5*(0.5*sin(time / 300.0) + 0.5)) * 
             vec3(0.0, 1.0, 1.0), 
             rNormal, FragPos, viewDir, 1.0, 0.35, 0.44);
+    result += cellLights(rNormal, FragPos, viewDir);
 
-    color = texture(ourTexture, TexCoord);
+    color = isFloor != 0 ? texture(floorTexture, TexCoord) :
+                           texture(wallTexture, TexCoord);
     color = vec4(result * color.rgb, color.a);
 }
 
@@ -66,7 +120,7 @@ void main()
  * https://github.com/stegu/webgl-noise (MIT license)
  * classicnoise3D.glsl file - just 3D perlin noise used to
  * slightly offset the face normals for some variety in the
- * lighting, nothing else.
+ * lighting, nothing else. Only used with the baked noise off.
  */
 
 vec3 mod289(vec3 x)
@@ -1,22 +1,54 @@
 #version 450 core
 
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec2 texCoord;
+// One instance per straight run of wall faces or floor tiles of the
+// baked maze. Every instance is the same unit quad, placed in the world
+// from the first tile of the run and its kind - 0-3 a wall facing that
+// way (Dir order: north, east, south, west), 4 the floor - and stretched
+// along the run. Texture coordinates run 0 to the length so the textures
+// repeat once per tile as before.
+
+layout (location = 0) in vec2 corner;
+layout (location = 1) in vec4 instance; // tile x, tile y, kind, length
 
 out vec2 TexCoord;
 out vec3 FragPos;
 out vec3 nNormal;
+flat out int isFloor;
+
+#include "frame.glsl"
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 normal;
+const float FLOOR_Z = 0.5;
+const float WALL_HEIGHT = 5.0;
+const vec2 NORMALS[4] = vec2[](
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(0.0, -1.0), vec2(-1.0, 0.0)
+);
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(position, 1.0);
-    FragPos = vec3(model * vec4(position, 1.0));
-    TexCoord = texCoord;
-    // Normal matrix to ensure normals are uniform
-    nNormal = mat3(transpose(inverse(model))) * normal;
+    int kind = int(instance.z);
+    vec2 tile = instance.xy;
+    float runLength = instance.w;
+    vec3 pos;
+    if (kind == 4) {
+        pos = vec3(tile + vec2(corner.x*runLength, corner.y), FLOOR_Z);
+        nNormal = vec3(0.0, 0.0, 1.0);
+        TexCoord = vec2(corner.x*runLength, corner.y);
+    } else {
+        // Wall on the tiles' side opposite its normal, running along the
+        // tangent so the quad winds counter-clockwise seen from the tiles.
+        // Runs go up x or y, so a tangent pointing down starts at the
+        // run's last tile.
+        vec2 n = NORMALS[kind];
+        vec2 t = vec2(-n.y, n.x);
+        vec2 base = tile + 0.5 - 0.5*n - 0.5*t;
+        if (t.x + t.y < 0.0)
+            base += (runLength - 1.0) * abs(t);
+        pos = vec3(base + corner.x*runLength*t,
+                   FLOOR_Z + corner.y*WALL_HEIGHT);
+        nNormal = vec3(n, 0.0);
+        TexCoord = vec2(corner.x*runLength, (1.0 - corner.y) * WALL_HEIGHT);
+    }
+    isFloor = kind == 4 ? 1 : 0;
+    FragPos = pos;
+    gl_Position = projection * view * vec4(pos, 1.0);
 }
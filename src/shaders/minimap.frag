@@ -1,22 +1,72 @@
 #version 450 core
 
-/* Creates drop shadow effect on minimap by sampling nearby TexCoords */
+/* Colours the minimap from the flags of each texel in the window, and
+ * creates drop shadow effect by looking at nearby texels */
 
-in vec2 TexCoord;
+in vec2 MapCoord;
 out vec4 color;
 
-uniform sampler2D ourTexture;
-uniform float shadowSize;
+uniform usampler2D tiles;   // Flags of each texel, as in minimap.cpp
+uniform ivec2 origin;       // First texel of the window shown
+uniform ivec2 player;
+uniform bool showPath;
 
+#include "frame.glsl"
+
+// Texels across the window, as in minimap.cpp
+const float MAP_TILES = 32.0;
+
+const uint OPEN = 1u;
+const uint PATH = 2u;
+const uint ENTRANCE = 4u;
+const uint EXIT = 8u;
+const uint VISITED = 16u;
+const uint DENSITY_SHIFT = 5u;
+const float DENSITY_MAX = 7.0;
+
+const vec4 FLOOR_COLOR = vec4(1.0);
+const vec4 PATH_COLOR = vec4(vec3(150.0), 255.0) / 255.0;
+const vec4 ENTRANCE_COLOR = vec4(0.0, 200.0, 50.0, 255.0) / 255.0;
+const vec4 EXIT_COLOR = vec4(0.0, 1.0, 1.0, 1.0);
+const vec4 EXPLORED_COLOR = vec4(110.0, 20.0, 20.0, 255.0) / 255.0;
+const vec4 PLAYER_COLOR = vec4(1.0, 0.0, 0.0, 1.0);
+
+vec4 flagColor(uint flags) {
+    if ((flags & VISITED) != 0u)
+        return EXPLORED_COLOR;
+    if ((flags & ENTRANCE) != 0u)
+        return ENTRANCE_COLOR;
+    if ((flags & EXIT) != 0u)
+        return EXIT_COLOR;
+    return showPath && (flags & PATH) != 0u ? PATH_COLOR : FLOOR_COLOR;
+}
+
+// Walls are transparent. Zoomed out, texels with fewer open tiles in
+// them are darker. The texture wraps, it is a ring around the player.
+vec4 tileColor(vec2 mapCoord) {
+    ivec2 texel = origin + ivec2(floor(mapCoord * MAP_TILES));
+    uint flags = texelFetch(tiles, texel % textureSize(tiles, 0), 0).r;
+    if ((flags & OPEN) == 0u)
+        return vec4(0.0);
+    if (texel == player)
+        return PLAYER_COLOR;
+    float density = float(flags >> DENSITY_SHIFT) / DENSITY_MAX;
+    return vec4(flagColor(flags).rgb * (0.5 + 0.5 * density), 1.0);
+}
+
+// Walls are shadowed by the floor up and to the right of them, but not
+// past the window's edges
 float border() {
-    if (TexCoord.x + shadowSize > 1.0 || TexCoord.y + shadowSize > 1.0)
+    if (MapCoord.x + shadowSize > 1.0 || MapCoord.y + shadowSize > 1.0)
         return 0.0;
-    return texture(ourTexture, TexCoord + shadowSize).w;
+    return tileColor(MapCoord + shadowSize).a;
 }
 
 void main()
 {
-    color = texture(ourTexture, TexCoord);
+    color = tileColor(MapCoord);
     if (color.w == 0)
         color.w = border();
+    // Drawn over the scene after the fade, so fades itself
+    color.rgb *= brightness;
 }
@@ -1,23 +1,21 @@
-#version 330 core
+#version 450 core
 
-// Create fade effect for when victory is achieved, if fade float
-// passed in as uniform is not 0 (1 = fade in, 2 = fade out)
+// Fade effect for when victory is achieved, brightness in the frame
+// uniforms goes 1 -> 0 to fade out and back to fade in. Also scales the
+// scene up to the window when it was drawn at a lower resolution.
 
 in vec2 TexCoords;
 out vec4 color;
 
 uniform sampler2D screenTexture;
-uniform float time;
-uniform float fade;
+
+#include "frame.glsl"
 
 void main()
 {
-    color = texture(screenTexture, TexCoords);
-    if (fade >= 1.5) {
-        float modT = 1.0 - mod(time, 300)/300.0;
-        color = modT * color;
-    } else if (fade >= 0.5) {
-        float modT = mod(time, 150)/150.0;
-        color = modT * color;
-    }
+    // Scene only fills the bottom left sceneScale of the target, stay
+    // half a texel inside it so filtering doesn't pick up the rest
+    vec2 halfTexel = 0.5 / vec2(textureSize(screenTexture, 0));
+    vec2 uv = min(TexCoords * sceneScale, sceneScale - halfTexel);
+    color = brightness * texture(screenTexture, uv);
 }
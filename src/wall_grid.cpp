@@ -0,0 +1,36 @@
+#include "wall_grid.h"
+
+void WallGrid::resize(int w, int h) {
+    cellsW = w;
+    cellsH = h;
+    blocksW = (w + 7) / 8;
+    const int blocksH = (h + 7) / 8;
+    words.assign((size_t) blocksW * blocksH * PLANES, 0);
+    words.shrink_to_fit();
+    fill();
+}
+
+void WallGrid::fill() {
+    for (size_t i = 0; i < words.size(); i += PLANES) {
+        words[i + EAST] = ~(uint64_t) 0;
+        words[i + NORTH] = ~(uint64_t) 0;
+        words[i + PATH] = 0;
+    }
+}
+
+void WallGrid::carve(int cx, int cy, Dir d) {
+    switch (d) {
+        case Dir::East:
+            words[word(cx, cy, EAST)] &= ~bit(cx, cy);
+            break;
+        case Dir::North:
+            words[word(cx, cy, NORTH)] &= ~bit(cx, cy);
+            break;
+        case Dir::West:
+            words[word(cx - 1, cy, EAST)] &= ~bit(cx - 1, cy);
+            break;
+        case Dir::South:
+            words[word(cx, cy - 1, NORTH)] &= ~bit(cx, cy - 1);
+            break;
+    }
+}
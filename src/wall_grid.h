@@ -0,0 +1,144 @@
+#ifndef WALL_GRID_H
+#define WALL_GRID_H
+
+/*
+ * WallGrid - compact storage for a maze of W x H logical cells.
+ *
+ * Only the wall on the east (+x) and north (+y) side of each cell is kept,
+ * since a cell's west/south walls are the east/north walls of its
+ * neighbours. The outer border and the pillars between cells are always
+ * solid so are never stored. A third bit marks cells on the optimal path.
+ *
+ * Cells are packed into 8x8 blocks, one 64-bit word per bit plane per
+ * block, all in one contiguous buffer, so neighbouring cells in either
+ * direction usually share a cache line. That is 3 bits per cell, rather
+ * than 4+ bytes for the expanded tile grid.
+ *
+ * The rest of the program still thinks in terms of the expanded
+ * (2W+1)x(2H+1) tile grid, where cell (cx, cy) is tile (2cx+1, 2cy+1), so
+ * type() answers queries in those coordinates.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Direction a wall in maze is facing
+enum class Dir {
+    North,
+    East,
+    South,
+    West
+};
+
+enum class Type : uint8_t {
+    Wall = 0,
+    Floor,
+    Entrance,
+    Exit,
+    Path
+};
+
+struct Tile {
+    Type type;
+};
+
+class WallGrid {
+public:
+    WallGrid() : cellsW(0), cellsH(0), blocksW(0) {}
+    WallGrid(int w, int h) { resize(w, h); }
+
+    void resize(int w, int h);
+    // Close every wall and clear the path
+    void fill();
+
+    int getCellsW() const { return cellsW; }
+    int getCellsH() const { return cellsH; }
+    // Size of the expanded tile grid
+    int getWidth() const { return cellsW*2 + 1; }
+    int getHeight() const { return cellsH*2 + 1; }
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+    // Is there a passage from cell (cx, cy) in direction d?
+    bool open(int cx, int cy, Dir d) const;
+    // Knock down wall between cell (cx, cy) and its neighbour in direction d
+    void carve(int cx, int cy, Dir d);
+    bool onPath(int cx, int cy) const {
+        return words[word(cx, cy, PATH)] & bit(cx, cy);
+    }
+    void setPath(int cx, int cy) { words[word(cx, cy, PATH)] |= bit(cx, cy); }
+
+    // Tile type in expanded coordinates (Floor/Path/Wall only, the maze
+    // knows where its entrance and exit are)
+    Type type(int x, int y) const;
+    bool isWall(int x, int y) const { return type(x, y) == Type::Wall; }
+
+    // East/north walls of the 8 cells (8bx .. 8bx+7, cy), bit i for cell
+    // 8bx+i. Cells past the east edge read as walls.
+    uint8_t eastWalls(int bx, int cy) const { return rowByte(bx, cy, EAST); }
+    uint8_t northWalls(int bx, int cy) const { return rowByte(bx, cy, NORTH); }
+
+private:
+    enum Plane { EAST = 0, NORTH, PATH, PLANES };
+
+    int cellsW;
+    int cellsH;
+    int blocksW; // Width in 8x8 blocks
+    std::vector<uint64_t> words;
+
+    size_t word(int cx, int cy, int plane) const {
+        return ((size_t) (cy >> 3) * blocksW + (cx >> 3)) * PLANES + plane;
+    }
+    static uint64_t bit(int cx, int cy) {
+        return (uint64_t) 1 << (((cy & 7) << 3) | (cx & 7));
+    }
+    bool wallBit(int cx, int cy, int plane) const {
+        return words[word(cx, cy, plane)] & bit(cx, cy);
+    }
+    uint8_t rowByte(int bx, int cy, int plane) const {
+        return words[word(bx << 3, cy, plane)] >> ((cy & 7) << 3);
+    }
+};
+
+inline bool WallGrid::open(int cx, int cy, Dir d) const {
+    switch (d) {
+        case Dir::East:  return !wallBit(cx, cy, EAST);
+        case Dir::North: return !wallBit(cx, cy, NORTH);
+        case Dir::West:  return cx > 0 && !wallBit(cx - 1, cy, EAST);
+        case Dir::South: return cy > 0 && !wallBit(cx, cy - 1, NORTH);
+    }
+    return false;
+}
+
+inline Type WallGrid::type(int x, int y) const {
+    const bool oddX = x & 1;
+    const bool oddY = y & 1;
+    if (oddX && oddY)
+        return onPath(x >> 1, y >> 1) ? Type::Path : Type::Floor;
+    if (!oddX && !oddY)
+        return Type::Wall;
+
+    // Passage between two cells - the wall bit belongs to the cell
+    // to the west/south of it, border walls are always solid
+    int cx, cy, nx, ny;
+    if (!oddX) {
+        if (x == 0 || x == getWidth() - 1)
+            return Type::Wall;
+        cx = (x >> 1) - 1, cy = y >> 1;
+        nx = cx + 1, ny = cy;
+        if (wallBit(cx, cy, EAST))
+            return Type::Wall;
+    } else {
+        if (y == 0 || y == getHeight() - 1)
+            return Type::Wall;
+        cx = x >> 1, cy = (y >> 1) - 1;
+        nx = cx, ny = cy + 1;
+        if (wallBit(cx, cy, NORTH))
+            return Type::Wall;
+    }
+    // Maze is a tree, so two connected cells on the path means the
+    // passage between them is on it too
+    return onPath(cx, cy) && onPath(nx, ny) ? Type::Path : Type::Floor;
+}
+
+#endif
@@ -2,46 +2,206 @@
 #define WORLD_H
 
 /*
- * World - contains a maze, camera, minimap. Handles some option toggling
- * with input. Purely header since it is so small.
+ * World - contains a maze, camera, minimap and the lights placed in the
+ * maze. Handles some option toggling with input. Purely header since it
+ * is so small.
+ *
+ * The world is simulated in fixed ticks at the rate given in Settings,
+ * however often it is drawn. advance() runs however many ticks fit in
+ * the time that has passed and the view is interpolated between the last
+ * two, so game speed doesn't depend on frame rate.
+ *
+ * Nothing here touches GL or GLUT, input comes through whichever Input
+ * the world is given, so it can be ticked without a window.
  */
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
 #include "maze.h"
 #include "camera.h"
 #include "minimap.h"
+#include "settings.h"
+#include "light_grid.h"
+#include "random.h"
+#include "bitplane.h"
+
+// Tiles
+const static float MIN_VIEW_DISTANCE = 2.0f;
+const static float MAX_VIEW_DISTANCE = 200.0f;
+const static float TORCH_RADIUS = 4.0f;
+const static float BREADCRUMB_RADIUS = 2.5f;
+const static glm::vec3 TORCH_COLOR(1.0f, 0.55f, 0.2f);
+const static glm::vec3 BREADCRUMB_COLOR(0.4f, 0.6f, 1.0f);
 
 class World {
 public:
-    World(int w, int h, int mazeW, int mazeH) : 
-        maze(mazeW, mazeH),
+    World(int w, int h, const Settings& s, Input& input) : 
+        maze(s.mazeW, s.mazeH, s.algorithm, s.seed, s.threads, s.endless),
+        input(input),
         camera(input),
-        minimap(maze, w, h) {}
+        minimap(maze, w, h),
+        viewDistance(s.viewDistance),
+        pvs(s.pvs),
+        stats(s.stats),
+        bakedNoise(true),
+        targetFps(s.targetFps),
+        tickLength(1.0f / s.tickRate),
+        accumulator(0.0f),
+        alpha(0.0f),
+        fade(Fade::None),
+        fadeTime(0.0f),
+        torches(s.torches),
+        lightsVersion(0),
+        torchRng(s.seed) {
+        placeTorches();
+        if (stats)
+            printMazeStats();
+    }
     ~World() {}
 
+    // Run the ticks that fit in seconds of real time, plus what was left
+    // over last time
+    void advance(float seconds) {
+        // Don't try to catch up after a long stall, like the window
+        // being dragged
+        accumulator += std::min(seconds, 0.25f);
+        while (accumulator >= tickLength) {
+            tick();
+            accumulator -= tickLength;
+        }
+        alpha = accumulator / tickLength;
+    }
+
     void tick() {
         if (input.getJust('m'))
             minimap.toggle();
         if (input.getJust('p'))
             minimap.togglePath();
+        // Zoom the minimap out and in
+        const int scroll = input.getScroll();
+        if (input.getJust('-') || scroll < 0)
+            minimap.zoom(1);
+        if (input.getJust('=') || scroll > 0)
+            minimap.zoom(-1);
+        if (input.getJust('n'))
+            bakedNoise = !bakedNoise;
+        // Drop a breadcrumb light where the player stands
+        if (input.getJust('b'))
+            addLight(glm::vec3(camera.getPos(), 0.7f), BREADCRUMB_COLOR,
+                     BREADCRUMB_RADIUS);
         if (input.getJust('z'))
             exit(0);
-        camera.update(maze);
+        if (input.getJust(']'))
+            viewDistance = std::min(viewDistance * 1.5f, MAX_VIEW_DISTANCE);
+        if (input.getJust('['))
+            viewDistance = std::max(viewDistance / 1.5f, MIN_VIEW_DISTANCE);
+        maze.stream(camera.getPos());
+        camera.update(maze, tickLength);
         minimap.update(camera.getPos());
+
+        // Fade out when player has reached end of maze, reset maze and
+        // fade back in
+        if (fade == Fade::None && maze.won()) {
+            fade = Fade::Out;
+            fadeTime = 0.0f;
+            if (stats)
+                printExplored();
+        } else if (fade != Fade::None) {
+            fadeTime += tickLength;
+            if (fade == Fade::Out && fadeTime >= FADE_OUT_TIME) {
+                reset();
+                fade = Fade::In;
+                fadeTime = 0.0f;
+            } else if (fade == Fade::In && fadeTime >= FADE_IN_TIME) {
+                fade = Fade::None;
+            }
+        }
+    }
+
+    // How bright the screen should be with the end of maze fade, 0-1
+    float getBrightness() {
+        float t = fadeTime + alpha * tickLength;
+        switch (fade) {
+            case Fade::Out: return std::max(0.0f, 1.0f - t / FADE_OUT_TIME);
+            case Fade::In:  return std::min(1.0f, t / FADE_IN_TIME);
+            default:        return 1.0f;
+        }
     }
 
     void reset() {
         maze.reset();
         camera.reset();
         minimap.reset(maze);
+        clearLights();
+        placeTorches();
+        if (stats)
+            printMazeStats();
+    }
+
+    // Point lights in the maze, besides the player's own and the exit's.
+    // Returns the light's id, an index into getLights().
+    int addLight(glm::vec3 pos, glm::vec3 color, float radius) {
+        lights.push_back({pos, radius, color, 0.0f});
+        ++lightsVersion;
+        return lights.size() - 1;
+    }
+
+    void clearLights() {
+        lights.clear();
+        ++lightsVersion;
+    }
+
+    const std::vector<PointLight>& getLights() {
+        return lights;
+    }
+
+    // Changes whenever the lights do
+    uint64_t getLightsVersion() {
+        return lightsVersion;
+    }
+
+    // Move the player straight to pos, facing yaw radians anticlockwise
+    // from north. Ticks still move them from there with the input.
+    void placeCamera(glm::vec2 pos, float yaw) {
+        camera.place(pos, yaw);
+    }
+
+    // Tiles away the maze is drawn to
+    float getViewDistance() {
+        return viewDistance;
     }
 
+    // Interpolated between the last two ticks
     glm::mat4 getView() {
-        return camera.getView();
+        return camera.getView(alpha);
     }
 
     glm::vec2 getPos() {
-        return camera.getPos();
+        return camera.getPos(alpha);
+    }
+
+    // Whether the renderer should only draw what can be seen from the
+    // player's tile
+    bool usesPvs() {
+        return pvs;
+    }
+
+    // Whether timings and counts should be printed
+    bool showsStats() {
+        return stats;
+    }
+
+    // Frame rate the renderer should lower resolution to keep, 0 if it
+    // should always draw at full resolution
+    int getTargetFps() {
+        return targetFps;
+    }
+
+    // Whether the maze's lighting noise is looked up from a texture
+    // rather than worked out per fragment, toggled with 'n'
+    bool usesBakedNoise() {
+        return bakedNoise;
     }
 
     Maze& getMaze() {
@@ -53,10 +213,78 @@ public:
     }
 
 private:
+    enum class Fade { None, Out, In };
+    // Seconds
+    static constexpr float FADE_OUT_TIME = 5.0f;
+    static constexpr float FADE_IN_TIME = 2.5f;
+
+    // How much of the maze the player saw on the way to the exit, for
+    // --stats
+    void printExplored() {
+        size_t open = std::max<size_t>(1, minimap.getOpenTiles());
+        std::cout << "Explored " << minimap.getExplored() << " of "
+            << minimap.getOpenTiles() << " tiles ("
+            << 100 * minimap.getExplored() / open << "%), "
+            << minimap.getPathExplored() << " of "
+            << minimap.getPathTiles() << " on the path\n";
+    }
+
+    // Shape of a fixed maze, from its wall bitplane: dead ends and
+    // junctions, and how many wall faces merge into how many straight
+    // runs (as the renderer draws them). For --stats.
+    void printMazeStats() {
+        if (maze.isEndless())
+            return;
+        Bitplane walls, faces[4];
+        size_t deadEnds, junctions, count = 0;
+        std::vector<FaceRun> runs;
+        wallPlane(maze.getGrid(), walls);
+        countBranches(walls, deadEnds, junctions);
+        exposedFaces(walls, faces);
+        for (int d = 0; d < 4; ++d) {
+            count += faces[d].count();
+            faceRuns(faces[d], (Dir) d, runs);
+        }
+        std::cout << "Maze: " << deadEnds << " dead ends, " << junctions
+            << " junctions, " << count << " wall faces in " << runs.size()
+            << " runs\n";
+    }
+
+    // Torches on random open tiles, halfway up the walls
+    void placeTorches() {
+        if (maze.isEndless())
+            return;
+        for (int i = 0; i < torches; ++i) {
+            int x, y;
+            do {
+                x = 1 + torchRng.below(maze.getWidth() - 2);
+                y = 1 + torchRng.below(maze.getHeight() - 2);
+            } while (maze.getTile(x, y).type == Type::Wall);
+            addLight(glm::vec3(x + 0.5f, y + 0.5f, 2.5f), TORCH_COLOR,
+                     TORCH_RADIUS);
+        }
+    }
+
     Maze maze;
-    Input input;
+    Input& input;
     Camera camera;
     Minimap minimap;
+
+    float viewDistance;
+    bool pvs;
+    bool stats;
+    bool bakedNoise;
+    int targetFps;
+    float tickLength;  // Seconds per tick
+    float accumulator; // Time not yet simulated
+    float alpha;       // How far between the last two ticks to draw
+    Fade fade;
+    float fadeTime;
+
+    int torches;
+    std::vector<PointLight> lights;
+    uint64_t lightsVersion;
+    Random torchRng;
 };
 
 #endif